@@ -32,6 +32,10 @@
 #define INCLUDED_LAYER_H
 #endif
 
+#ifndef INCLUDED_CORRUPTION_H
+#include "Corruption.h"
+#endif
+
 //------------------------------------------------------------------------------
 
 namespace rook { 
@@ -40,18 +44,27 @@ namespace rook {
 
 template <size_t X, size_t Y>
 struct Autoencoder {
-  // Use regular feed-forward layers
+  // The decoder is a regular feed-forward layer.  The encoder has only a
+  // bias of its own: its weights are the transpose of the decoder's, read
+  // in place.
   typedef rook::Layer<Y, X, Sigmoid>   Decoder;
-  typedef rook::Layer<X, Y, Sigmoid>   Encoder;
+  typedef ColVector<Y, float>          EncoderBias;
 
-  typedef typename Encoder::Input  Input;
-  typedef typename Encoder::Output Code;
+  typedef typename Decoder::Output Input;
+  typedef typename Decoder::Input  Code;
+
+  Autoencoder()
+  : corruption  (Corruption::dropout(0.4f)) {
+    Initialization::normal(Decoder::initialMean, Decoder::initialDeviation).fill(encoderBias.raw().data(), Y);
+  }
 
-  // Encoding is just a forward pass through the encoder layer
-  // (constrained to be the transpose of the decoding layer)
+  // Encoding is a forward pass through the transpose of the decoder's 
+  // weights, W' * x, without ever forming W'
   Code
   encode(Input const& input) const {
-    return encoder.infer(input);
+    Code code = gemv_t(decoder.getWeightMatrix(), input) + encoderBias;
+    Sigmoid::activate(code.raw().data(), code.raw().data(), Y);
+    return code;
   }
 
   // Decoding is just a forward pass through the decoder layer
@@ -67,25 +80,29 @@ struct Autoencoder {
     return decode(encode(input));
   }
 
-  // For learning, we constrain the encoder and decoder to share
-  // weights (but not biases)
-  // TODO only learn decoder and encoder's bias - better sharing
-  // no need for copy or transpose
+  // For learning, the encoder and decoder share weights (but not biases):
+  // both halves' updates go into the one matrix.  The encoder's target is
+  // its code plus the error back propagated from the decoder, and its 
+  // update is taken against the (corrupted) input it actually saw.
   Input
   learn(Input  const& input, float learningRate = 0.1f) {
-    // Reconstruct the input
-    auto corrupted = input.apply([](float a) -> float {
-      return (rand()%100<60) ? a : 0.0f;
-    });
+    // Reconstruct the input, from a corrupted copy drawn from this
+    // thread's own random stream
+    const Input corrupted = corruption.apply(input);
     auto code   = encode(corrupted);
     auto recon  = decode(code);
 
-    // Update the weights and biases
-    auto decoderError  = decoder.learn(code, recon, input, learningRate);
-    auto encoderError  = encoder.learn(input, code, std::get<0>(decoderError), learningRate);
+    // Update the decoder, W += lr * delta * code', and back propagate
+    auto decoderError = decoder.learn(code, recon, input, learningRate);
 
-    // Tie our weights (but not biases)
-    encoder.getWeightMatrix() = decoder.getWeightMatrix().transpose();
+    // Update the encoder: its weights are W', so W' += lr * delta * x' is
+    // W += lr * x * delta'
+    Code delta;
+    Sigmoid::derive(code.raw().data(), delta.raw().data(), Y);
+    delta = (delta % std::get<0>(decoderError)).apply(pure([=](float d) { return d * learningRate; }));
+    encoderBias += delta;
+    gemm::ger(X, Y, corrupted.raw().data(), delta.raw().data(), 
+              decoder.getWeightMatrix().raw().data(), Y);
 
     return std::get<1>(decoderError);
   }
@@ -95,8 +112,9 @@ struct Autoencoder {
     return decoder.getWeightMatrix();
   }
 
-  Decoder  decoder;
-  Encoder  encoder;
+  Decoder      decoder;
+  EncoderBias  encoderBias;
+  Corruption   corruption;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,380 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_CHECKPOINT_H
+#define INCLUDED_CHECKPOINT_H
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_AUTOENCODER_H
+#include "Autoencoder.h"
+#endif
+
+#ifndef INCLUDED_DYNAMICLAYER_H
+#include "DynamicLayer.h"
+#endif
+
+#ifndef INCLUDED_IDXDATASET_H
+#include "IdxDataset.h"
+#endif
+
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Checkpoint files.  A 64 byte header, a 64 byte record per layer, then each
+// layer's weights (row-major) and bias as raw floats, every block starting
+// on a 64 byte boundary:
+//
+//   CheckpointHeader
+//   CheckpointLayer  x layers
+//   weights 0, bias 0, weights 1, bias 1, ...
+//
+// A layer whose weights are tied to an earlier layer's (the encoder half of
+// an Autoencoder) has no weight block of its own: it uses that layer's, 
+// transposed.
+//
+// Everything is native-endian; a checkpoint written on a machine of the
+// other endianness is rejected rather than byte-swapped.
+const char     CheckpointMagic[8] = {'R', 'O', 'O', 'K', 'C', 'K', 'P', 'T'};
+const uint32_t CheckpointVersion  = 1;
+const uint32_t CheckpointEndian   = 0x01020304;
+
+struct CheckpointHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t layers;
+  uint32_t reserved[11];
+};
+
+struct CheckpointLayer {
+  uint32_t inputs;
+  uint32_t outputs;
+  uint32_t activation;   // ActivationType
+  uint32_t tied;         // 1 + the layer whose weights these transpose, or 0
+  uint64_t weights;      // offsets of each block, from the start of the file
+  uint64_t bias;
+  uint64_t reserved[4];
+};
+
+static_assert(sizeof(CheckpointHeader) == 64, "checkpoint header is one cache line");
+static_assert(sizeof(CheckpointLayer)  == 64, "checkpoint layer is one cache line");
+
+// Which ActivationType a Layer's activation is
+template <typename Activation> struct ActivationCode;
+template <> struct ActivationCode<Sigmoid> { static const ActivationType value = ActivationType::Sigmoid; };
+template <> struct ActivationCode<Linear>  { static const ActivationType value = ActivationType::Linear;  };
+template <> struct ActivationCode<Sinc>    { static const ActivationType value = ActivationType::Sinc;    };
+template <> struct ActivationCode<Hinge>   { static const ActivationType value = ActivationType::Hinge;   };
+
+inline size_t 
+alignBlock(size_t offset) {
+  return (offset + Alignment - 1)/Alignment*Alignment;
+}
+
+//------------------------------------------------------------------------------
+// Lays out a checkpoint in memory, then writes it with a single write(2) to
+// a temporary file that is renamed over path - readers see the old 
+// checkpoint or the new one, never half of one
+struct CheckpointWriter {
+  template <size_t X, size_t Y, typename A, typename L>
+  void add(const Layer<X, Y, A, L>& layer) {
+    Block block = {X, Y, ActivationCode<A>::value, 
+                   layer.getWeightMatrix().raw().data(), 
+                   layer.getBias().raw().data(), 0};
+    blocks_.push_back(block);
+  }
+
+  // A layer with its own bias, and the transpose of layer i's weights
+  void addTied(size_t i, ActivationType activation, const float* bias) {
+    Block block = {blocks_[i].outputs, blocks_[i].inputs, activation, 
+                   nullptr, bias, i + 1};
+    blocks_.push_back(block);
+  }
+
+  void write(const std::string& path) const {
+    size_t offset = sizeof(CheckpointHeader) + blocks_.size()*sizeof(CheckpointLayer);
+    std::vector<CheckpointLayer> records;
+    for (const auto& block : blocks_) {
+      CheckpointLayer record;
+      std::memset(&record, 0, sizeof(record));
+      record.inputs     = block.inputs;
+      record.outputs    = block.outputs;
+      record.activation = (uint32_t)block.activation;
+      record.tied       = block.tied;
+      if (block.tied) {
+        record.weights  = records[block.tied - 1].weights;
+      } else {
+        record.weights  = offset = alignBlock(offset);
+        offset += block.inputs*block.outputs*sizeof(float);
+      }
+      record.bias       = offset = alignBlock(offset);
+      offset += block.outputs*sizeof(float);
+      records.push_back(record);
+    }
+
+    AlignedArray<uint8_t> image(alignBlock(offset));
+    std::memset(image.data(), 0, image.size());
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CheckpointMagic, sizeof(header.magic));
+    header.version = CheckpointVersion;
+    header.endian  = CheckpointEndian;
+    header.layers  = blocks_.size();
+    std::memcpy(image.data(), &header, sizeof(header));
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      const auto& block  = blocks_[i];
+      const auto& record = records[i];
+      std::memcpy(image.data() + sizeof(header) + i*sizeof(record), &record, sizeof(record));
+      if (!block.tied) {
+        std::memcpy(image.data() + record.weights, block.weights, block.inputs*block.outputs*sizeof(float));
+      }
+      std::memcpy(image.data() + record.bias,    block.bias,    block.outputs*sizeof(float));
+    }
+
+    const std::string temporary = path + ".tmp";
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error(temporary + ": cannot create");
+    }
+    size_t written = 0;
+    while (written < image.size()) {
+      const ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+      if (n <= 0) {
+        ::close(fd);
+        std::remove(temporary.c_str());
+        throw std::runtime_error(temporary + ": cannot write");
+      }
+      written += n;
+    }
+    ::close(fd);
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error(path + ": cannot replace");
+    }
+  }
+
+private:
+  struct Block {
+    size_t         inputs;
+    size_t         outputs;
+    ActivationType activation;
+    const float*   weights;
+    const float*   bias;
+    size_t         tied;
+  };
+
+  std::vector<Block> blocks_;
+};
+
+//------------------------------------------------------------------------------
+// A checkpoint mapped into memory.  Restoring a network validates every 
+// layer's shape and activation against the network's own, then points the 
+// network's (heap) weight matrices straight at the mapping - nothing is 
+// parsed or copied but the small, inline matrices.  The mapping is private,
+// so a restored network can go on learning without touching the file, but
+// the Checkpoint must outlive every network restored from it.
+struct Checkpoint {
+  explicit Checkpoint(const std::string& path)
+  : path_ (path)
+  , file_ (path, true) {
+    if (file_.size() < sizeof(CheckpointHeader)) {
+      fail("too short for a header");
+    }
+    std::memcpy(&header_, file_.data(), sizeof(header_));
+    if (std::memcmp(header_.magic, CheckpointMagic, sizeof(header_.magic)) != 0) {
+      fail("not a checkpoint");
+    }
+    if (header_.endian != CheckpointEndian) {
+      fail("written with the other byte order");
+    }
+    if (header_.version != CheckpointVersion) {
+      fail("unsupported version " + std::to_string(header_.version));
+    }
+    if (file_.size() < sizeof(CheckpointHeader) + header_.layers*sizeof(CheckpointLayer)) {
+      fail("truncated layer table");
+    }
+    for (size_t i = 0; i < header_.layers; i++) {
+      const auto& record = layer(i);
+      if (record.tied > i) {
+        fail("layer " + std::to_string(i) + " is tied to a later layer");
+      }
+      if (record.weights % Alignment || record.bias % Alignment ||
+          !contains(record.weights, (uint64_t)record.inputs*record.outputs) ||
+          !contains(record.bias,    record.outputs)) {
+        fail("layer " + std::to_string(i) + " is out of bounds");
+      }
+    }
+  }
+
+  size_t layers() const { return header_.layers; }
+
+  const CheckpointLayer& layer(size_t i) const {
+    return reinterpret_cast<const CheckpointLayer*>(file_.data() + sizeof(CheckpointHeader))[i];
+  }
+
+  const uint8_t* data() const { return file_.data(); }
+  size_t         size() const { return file_.size(); }
+
+  template <size_t X, size_t Y, typename A, typename L>
+  void restore(size_t i, Layer<X, Y, A, L>& layer) {
+    const auto& record = require(i, X, Y, ActivationCode<A>::value, 0);
+    layer.getWeightMatrix().borrow(reinterpret_cast<float*>(file_.data() + record.weights));
+    layer.getBias().borrow(reinterpret_cast<float*>(file_.data() + record.bias));
+  }
+
+  template <size_t X, size_t Y, typename A, typename L>
+  void restore(Layer<X, Y, A, L>& layer) {
+    expect(1);
+    restore(0, layer);
+  }
+
+  template <typename...Layers>
+  void restore(FeedForwardNetwork<Layers...>& network) {
+    expect(sizeof...(Layers));
+    restoreLayers(0, network);
+  }
+
+  template <size_t X, size_t Y>
+  void restore(Autoencoder<X, Y>& autoencoder) {
+    expect(2);
+    restore(0, autoencoder.decoder);
+    const auto& record = require(1, X, Y, ActivationType::Sigmoid, 1);
+    autoencoder.encoderBias.borrow(reinterpret_cast<float*>(file_.data() + record.bias));
+  }
+
+private:
+  template <typename Output>
+  void restoreLayers(size_t i, FeedForwardNetwork<Output>& network) {
+    restore(i, network.getLayer());
+  }
+
+  template <typename Input, typename Next, typename...Rest>
+  void restoreLayers(size_t i, FeedForwardNetwork<Input, Next, Rest...>& network) {
+    restore(i, network.getLayer());
+    restoreLayers(i + 1, network.getRemainNetwork());
+  }
+
+  // Layer i, which must have the given shape, activation and tie
+  const CheckpointLayer& require(size_t i, size_t inputs, size_t outputs, 
+                                 ActivationType activation, uint32_t tied) const {
+    if (i >= layers()) {
+      fail("has no layer " + std::to_string(i));
+    }
+    const auto& record = layer(i);
+    if (record.inputs != inputs || record.outputs != outputs || 
+        record.activation != (uint32_t)activation || record.tied != tied) {
+      fail("layer " + std::to_string(i) + " is " + describe(record.inputs, record.outputs, record.activation, record.tied) +
+           "; expected " + describe(inputs, outputs, (uint32_t)activation, tied));
+    }
+    return record;
+  }
+
+  static std::string describe(size_t inputs, size_t outputs, uint32_t activation, uint32_t tied) {
+    return std::to_string(inputs) + "x" + std::to_string(outputs) + 
+           ", activation " + std::to_string(activation) + 
+           (tied ? ", tied to layer " + std::to_string(tied - 1) : "");
+  }
+
+  // Whether count floats from offset lie within the file - without 
+  // computing an end that a damaged offset could wrap around
+  bool contains(uint64_t offset, uint64_t count) const {
+    return offset <= file_.size() && count <= (file_.size() - offset)/sizeof(float);
+  }
+
+  void expect(size_t count) const {
+    if (layers() != count) {
+      fail("has " + std::to_string(layers()) + " layers; expected " + std::to_string(count));
+    }
+  }
+
+  void fail(const std::string& what) const {
+    throw std::runtime_error(path_ + ": " + what);
+  }
+
+  std::string      path_;
+  MappedFile       file_;
+  CheckpointHeader header_;
+};
+
+//------------------------------------------------------------------------------
+// Save a layer, network or autoencoder 
+template <size_t X, size_t Y, typename A, typename L>
+void 
+save(const std::string& path, const Layer<X, Y, A, L>& layer) {
+  CheckpointWriter writer;
+  writer.add(layer);
+  writer.write(path);
+}
+
+template <typename Output>
+void 
+addLayers(CheckpointWriter& writer, const FeedForwardNetwork<Output>& network) {
+  writer.add(network.getLayer());
+}
+
+template <typename Input, typename Next, typename...Rest>
+void 
+addLayers(CheckpointWriter& writer, const FeedForwardNetwork<Input, Next, Rest...>& network) {
+  writer.add(network.getLayer());
+  addLayers(writer, network.getRemainNetwork());
+}
+
+template <typename...Layers>
+void 
+save(const std::string& path, const FeedForwardNetwork<Layers...>& network) {
+  CheckpointWriter writer;
+  addLayers(writer, network);
+  writer.write(path);
+}
+
+template <size_t X, size_t Y>
+void 
+save(const std::string& path, const Autoencoder<X, Y>& autoencoder) {
+  CheckpointWriter writer;
+  writer.add(autoencoder.decoder);
+  writer.addTied(0, ActivationType::Sigmoid, autoencoder.encoderBias.raw().data());
+  writer.write(path);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
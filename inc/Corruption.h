@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_CORRUPTION_H
+#define INCLUDED_CORRUPTION_H
+
+#ifndef INCLUDED_RANDOM_H
+#include "Random.h"
+#endif
+
+#ifndef INCLUDED_MATRIX_H
+#include "Matrix.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Noise for denoising autoencoders (and data augmentation generally):
+//   Dropout        each input is zeroed with probability rate
+//   Gaussian       each input has N(0, deviation^2) added
+//   SaltAndPepper  each input is, with probability rate, set to 0 or 1
+//                  (equally likely)
+enum class Noise {
+  Dropout,
+  Gaussian,
+  SaltAndPepper
+};
+
+struct Corruption {
+  Noise noise;
+  float rate;
+  float deviation;
+
+  static Corruption dropout(float rate)         { return Corruption{Noise::Dropout,       rate, 0.0f}; }
+  static Corruption gaussian(float deviation)   { return Corruption{Noise::Gaussian,      1.0f, deviation}; }
+  static Corruption saltAndPepper(float rate)   { return Corruption{Noise::SaltAndPepper, rate, 0.0f}; }
+
+  // out[i] = in[i] corrupted, for i < n, drawing from random - by default
+  // this thread's stream, seeded from nextSeed().  Random numbers are made 
+  // and used a vector at a time; the tail is padded out to whole vectors.
+  // in and out may be the same.
+  void apply(const float* in, float* out, size_t n, CounterRandom& random = threadRandom()) const {
+    switch (noise) {
+      case Noise::Dropout:       run<DropoutOp>(in, out, n, random);       break;
+      case Noise::Gaussian:      run<GaussianOp>(in, out, n, random);      break;
+      case Noise::SaltAndPepper: run<SaltAndPepperOp>(in, out, n, random); break;
+    }
+  }
+
+  template <size_t M, size_t N, typename S>
+  Matrix<M, N, float, S> apply(const Matrix<M, N, float, S>& in, CounterRandom& random = threadRandom()) const {
+    Matrix<M, N, float, S> out;
+    apply(in.raw().data(), out.raw().data(), M*N, random);
+    return out;
+  }
+
+private:
+  // Each op corrupts Op::vectors whole vectors at a time: Gaussian noise 
+  // uses both halves of a Box-Muller pair
+  struct DropoutOp {
+    static const size_t vectors = 1;
+
+    template <typename V>
+    static void apply(const float* in, float* out, const Corruption& c, CounterRandom& random) {
+      V::store(out, V::andnot(V::less(random.uniform<V>(), V::set(c.rate)), V::load(in)));
+    }
+  };
+
+  struct GaussianOp {
+    static const size_t vectors = 2;
+
+    template <typename V>
+    static void apply(const float* in, float* out, const Corruption& c, CounterRandom& random) {
+      typename V::F z0, z1;
+      random.normal<V>(z0, z1);
+      const typename V::F x0 = V::load(in), x1 = V::load(in + V::width);
+      V::store(out,            V::fma(z0, V::set(c.deviation), x0));
+      V::store(out + V::width, V::fma(z1, V::set(c.deviation), x1));
+    }
+  };
+
+  struct SaltAndPepperOp {
+    static const size_t vectors = 1;
+
+    template <typename V>
+    static void apply(const float* in, float* out, const Corruption& c, CounterRandom& random) {
+      const typename V::F u    = random.uniform<V>();
+      const typename V::F hit  = V::less(u, V::set(c.rate));
+      const typename V::F salt = V::less(u, V::set(0.5f*c.rate));
+      V::store(out, V::select(hit, V::andf(salt, V::set(1.0f)), V::load(in)));
+    }
+  };
+
+  template <typename Op>
+  void run(const float* in, float* out, size_t n, CounterRandom& random) const {
+    typedef math::Native V;
+    const size_t w = Op::vectors*V::width;
+    size_t i = 0;
+    for (; i + w <= n; i += w) {
+      Op::template apply<V>(in + i, out + i, *this, random);
+    }
+    if (i < n) {
+      float tail[Op::vectors*V::width] = {0.0f};
+      std::copy(in + i, in + n, tail);
+      Op::template apply<V>(tail, tail, *this, random);
+      std::copy(tail, tail + (n - i), out + i);
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
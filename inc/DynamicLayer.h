@@ -0,0 +1,217 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_DYNAMICLAYER_H
+#define INCLUDED_DYNAMICLAYER_H
+
+#ifndef INCLUDED_DYNAMICMATRIX_H
+#include "DynamicMatrix.h"
+#endif
+
+#ifndef INCLUDED_LAYER_H
+#include "Layer.h"
+#endif
+
+#include <string>
+#include <tuple>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Activations chosen at run time, backed by the same vectorized kernels as
+// the Layer template parameters
+enum class ActivationType {
+  Sigmoid,
+  Linear,
+  Sinc,
+  Hinge
+};
+
+// "sigmoid", "linear", "sinc" or "hinge"
+inline ActivationType
+parseActivation(const std::string& name) {
+  if (name == "sigmoid") return ActivationType::Sigmoid;
+  if (name == "linear")  return ActivationType::Linear;
+  if (name == "sinc")    return ActivationType::Sinc;
+  if (name == "hinge")   return ActivationType::Hinge;
+  throw std::invalid_argument("unknown activation: " + name);
+}
+
+inline void
+activate(ActivationType type, const float* z, float* y, size_t n) {
+  switch (type) {
+    case ActivationType::Sigmoid: Sigmoid::activate(z, y, n); break;
+    case ActivationType::Linear:  Linear::activate(z, y, n);  break;
+    case ActivationType::Sinc:    Sinc::activate(z, y, n);    break;
+    case ActivationType::Hinge:   Hinge::activate(z, y, n);   break;
+  }
+}
+
+inline void
+derive(ActivationType type, const float* y, float* d, size_t n) {
+  switch (type) {
+    case ActivationType::Sigmoid: Sigmoid::derive(y, d, n); break;
+    case ActivationType::Linear:  Linear::derive(y, d, n);  break;
+    case ActivationType::Sinc:    Sinc::derive(y, d, n);    break;
+    case ActivationType::Hinge:   Hinge::derive(y, d, n);   break;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// The run-time shaped counterpart of Layer, with squared error loss.  
+// Inputs and outputs are batches, one sample per column, so a single 
+// sample is just a batch of one; learning from a batch of B averages the
+// B updates, exactly as Layer::learnBatch.
+struct DynamicLayer {
+  typedef DynamicMatrix<float> Batch;
+
+  constexpr static float initialMean      = 0.0f;
+  constexpr static float initialDeviation = 0.3f;
+
+  DynamicLayer(size_t inputs, size_t outputs, ActivationType activation = ActivationType::Sigmoid)
+  : DynamicLayer(inputs, outputs, Initialization::normal(initialMean, initialDeviation), activation)
+  {}
+
+  // Draw the weights according to a scheme - e.g. Initialization::he(inputs)
+  DynamicLayer(size_t inputs, size_t outputs, const Initialization& weights, 
+               ActivationType activation = ActivationType::Sigmoid)
+  : weightMatrix_ (outputs, inputs)
+  , bias_         (outputs, 1)
+  , activation_   (activation) {
+    requireShape(inputs > 0 && outputs > 0, "DynamicLayer: inputs and outputs must be non-zero");
+    weights.fill(weightMatrix_.data(), outputs*inputs);
+    Initialization::normal(initialMean, initialDeviation).fill(bias_.data(), outputs);
+  }
+
+  // Set the weights explicitly
+  DynamicLayer(const Batch& weightMatrix, const Batch& bias, ActivationType activation = ActivationType::Sigmoid)
+  : weightMatrix_ (weightMatrix)
+  , bias_         (bias)
+  , activation_   (activation) {
+    requireShape(bias.rows() == weightMatrix.rows() && bias.cols() == 1, 
+                 "DynamicLayer: bias must be a column of the weights' height");
+  }
+
+  size_t inputs()  const { return weightMatrix_.cols(); }
+  size_t outputs() const { return weightMatrix_.rows(); }
+
+  ActivationType activation() const { return activation_; }
+
+  Batch
+  infer(const Batch& input) const {
+    Batch output = weightMatrix_ * input;
+    float* row = output.data();
+    for (size_t i = 0; i < outputs(); i++, row += input.cols()) {
+      const float bias = bias_[i];
+      for (size_t b = 0; b < input.cols(); b++) {
+        row[b] += bias;
+      }
+    }
+    rook::activate(activation_, output.data(), output.data(), output.size());
+    return output;
+  }
+
+  std::tuple<Batch, Batch>
+  learn(const Batch& x, const Batch& y, const Batch& t, float learningRate = 0.1f) {
+    requireShape(t.rows() == y.rows() && t.cols() == y.cols(), "DynamicLayer::learn: target shape differs");
+    const Batch dError = t - y;
+    return std::make_tuple(update(x, y, dError, learningRate), loss(dError));
+  }
+
+  // Learn towards output + error, as Layer::correct
+  std::tuple<Batch, Batch>
+  correct(const Batch& input, const Batch& output, const Batch& error, float learningRate = 0.1f) {
+    requireShape(error.rows() == output.rows() && error.cols() == output.cols(), 
+                 "DynamicLayer::correct: error shape differs");
+    return std::make_tuple(update(input, output, error, learningRate), loss(error));
+  }
+
+  Batch& getWeightMatrix() {
+    return weightMatrix_;
+  }
+
+  Batch& getBias() {
+    return bias_;
+  }
+
+private:
+  static Batch loss(const Batch& dError) {
+    return dError.apply([](float x) { return 0.5f*x*x; });
+  }
+
+  // The same update as Layer: one fused pass over W for a single sample,
+  // and a rank-B GEMM for a batch
+  Batch
+  update(const Batch& x, const Batch& y, const Batch& dError, float learningRate) {
+    requireShape(x.rows() == inputs() && y.rows() == outputs() && x.cols() == y.cols(), 
+                 "DynamicLayer: batch shape differs from layer");
+    const size_t B    = x.cols();
+    const float  rate = learningRate/B;
+
+    Batch delta(outputs(), B);
+    rook::derive(activation_, y.data(), delta.data(), delta.size());
+    for (size_t i = 0; i < outputs(); i++) {
+      float dBias = 0.0f;
+      for (size_t b = 0; b < B; b++) {
+        delta.at(i, b) *= dError.at(i, b) * rate;
+        dBias += delta.at(i, b);
+      }
+      bias_[i] += dBias;
+    }
+
+    Batch result(inputs(), B);
+    if (B == 1) {
+      gemm::gerGemvT(outputs(), inputs(), delta.data(), x.data(), 
+                     weightMatrix_.data(), inputs(), 
+                     dError.data(), result.data());
+    } else {
+      gemm::multiply(outputs(), inputs(), B, 1.0f,
+                     delta.data(),         B, 1,
+                     x.data(),             1, B,
+                     weightMatrix_.data(), inputs(), 1);
+      gemm::multiply(inputs(), B, outputs(), 1.0f,
+                     weightMatrix_.data(), 1, inputs(),
+                     dError.data(),        B, 1,
+                     result.data(),        B, 1);
+    }
+    return result;
+  }
+
+  Batch          weightMatrix_;
+  Batch          bias_;
+  ActivationType activation_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
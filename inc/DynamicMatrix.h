@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_DYNAMICMATRIX_H
+#define INCLUDED_DYNAMICMATRIX_H
+
+#ifndef INCLUDED_MATRIX_H
+#include "Matrix.h"
+#endif
+
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+
+// A rows x cols matrix whose shape is only known at run time.  Elements
+// are row-major in cache-line aligned heap storage, exactly as in a heap
+// Matrix, so both share the same kernels (see Gemm.h).  Operations on
+// mismatched shapes throw std::invalid_argument.
+template <typename K = float>
+struct DynamicMatrix {
+  typedef K Field;
+
+  // Constructors - a new matrix is all zeros
+  DynamicMatrix();
+  DynamicMatrix(size_t rows, size_t cols);
+  template <typename F>
+  DynamicMatrix(size_t rows, size_t cols, F func) : DynamicMatrix(rows, cols) { generate(func); }
+  template <size_t M, size_t N, typename S>
+  explicit DynamicMatrix(Matrix<M, N, K, S> const& m);
+
+  DynamicMatrix(DynamicMatrix const& m);
+  DynamicMatrix(DynamicMatrix&& m);
+  DynamicMatrix& operator=(DynamicMatrix const& m);
+  DynamicMatrix& operator=(DynamicMatrix&& m);
+
+  // Shape
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  size_t size() const { return rows_*cols_; }
+
+  // Arithmetic
+  DynamicMatrix& operator+=(DynamicMatrix const& m);
+  DynamicMatrix& operator-=(DynamicMatrix const& m);
+
+  // Indexing
+  K  at(size_t i, size_t j) const { return data_[cols_*i + j]; }
+  K& at(size_t i, size_t j)       { return data_[cols_*i + j]; }
+
+  // Row-major linear indexing over all rows*cols elements
+  K  operator[](size_t i) const { return data_[i]; }
+  K& operator[](size_t i)       { return data_[i]; }
+
+  DynamicMatrix col(size_t j) const;
+  DynamicMatrix row(size_t i) const;
+  DynamicMatrix transpose() const;
+
+  void print(const std::string& name = "") const;
+
+  // Element-wise operations, as for Matrix
+  template <typename F> void          generate(F func);
+  template <typename F> DynamicMatrix apply(F func) const;
+
+  K*       data()       { return data_.data(); }
+  const K* data() const { return data_.data(); }
+
+private:
+  size_t          rows_;
+  size_t          cols_;
+  AlignedArray<K> data_;
+};
+
+// Throw std::invalid_argument unless a holds
+inline void
+requireShape(bool a, const char* what) {
+  if (!a) throw std::invalid_argument(what);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#include "DynamicMatrix.hpp"
+
+#endif
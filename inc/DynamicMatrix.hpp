@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_DYNAMICMATRIX_HPP
+#define INCLUDED_DYNAMICMATRIX_HPP
+
+#include <algorithm>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+
+namespace rook {
+
+//------------------------------------------------------------------------------
+
+template <typename K>
+DynamicMatrix<K>::DynamicMatrix()
+: rows_ (0)
+, cols_ (0) {
+}
+
+template <typename K>
+DynamicMatrix<K>::DynamicMatrix(size_t rows, size_t cols)
+: rows_ (rows)
+, cols_ (cols)
+, data_ (rows*cols) {
+  std::fill(data(), data() + size(), (K)0);
+}
+
+template <typename K>
+template <size_t M, size_t N, typename S>
+DynamicMatrix<K>::DynamicMatrix(Matrix<M, N, K, S> const& m)
+: rows_ (M)
+, cols_ (N)
+, data_ (M*N) {
+  std::copy(m.raw().begin(), m.raw().end(), data());
+}
+
+template <typename K>
+DynamicMatrix<K>::DynamicMatrix(DynamicMatrix const& m)
+: rows_ (m.rows_)
+, cols_ (m.cols_)
+, data_ (m.size()) {
+  std::copy(m.data(), m.data() + m.size(), data());
+}
+
+template <typename K>
+DynamicMatrix<K>::DynamicMatrix(DynamicMatrix&& m)
+: rows_ (m.rows_)
+, cols_ (m.cols_)
+, data_ (std::move(m.data_)) {
+  m.rows_ = m.cols_ = 0;
+}
+
+template <typename K>
+DynamicMatrix<K>&
+DynamicMatrix<K>::operator=(DynamicMatrix const& m) {
+  if (this != &m) {
+    if (size() != m.size()) {
+      data_ = AlignedArray<K>(m.size());
+    }
+    rows_ = m.rows_;
+    cols_ = m.cols_;
+    std::copy(m.data(), m.data() + m.size(), data());
+  }
+  return *this;
+}
+
+template <typename K>
+DynamicMatrix<K>&
+DynamicMatrix<K>::operator=(DynamicMatrix&& m) {
+  std::swap(rows_, m.rows_);
+  std::swap(cols_, m.cols_);
+  data_ = std::move(m.data_);
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename K>
+DynamicMatrix<K>&
+DynamicMatrix<K>::operator+=(DynamicMatrix const& m) {
+  requireShape(rows_ == m.rows_ && cols_ == m.cols_, "operator+=: shapes differ");
+  K*       a = data();
+  const K* b = m.data();
+  parallelFor(size(), 64/sizeof(K), size(), [=](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) a[i] += b[i];
+  });
+  return *this;
+}
+
+template <typename K>
+DynamicMatrix<K>&
+DynamicMatrix<K>::operator-=(DynamicMatrix const& m) {
+  requireShape(rows_ == m.rows_ && cols_ == m.cols_, "operator-=: shapes differ");
+  K*       a = data();
+  const K* b = m.data();
+  parallelFor(size(), 64/sizeof(K), size(), [=](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) a[i] -= b[i];
+  });
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename K>
+DynamicMatrix<K>
+DynamicMatrix<K>::col(size_t j) const {
+  DynamicMatrix result(rows_, 1);
+  for (size_t i = 0; i < rows_; i++) {
+    result[i] = at(i, j);
+  }
+  return result;
+}
+
+template <typename K>
+DynamicMatrix<K>
+DynamicMatrix<K>::row(size_t i) const {
+  DynamicMatrix result(1, cols_);
+  std::copy(data() + i*cols_, data() + (i + 1)*cols_, result.data());
+  return result;
+}
+
+template <typename K>
+DynamicMatrix<K>
+DynamicMatrix<K>::transpose() const {
+  DynamicMatrix result(cols_, rows_);
+  for (size_t i = 0; i < rows_; i++) {
+    for (size_t j = 0; j < cols_; j++) {
+      result.at(j, i) = at(i, j);
+    }
+  }
+  return result;
+}
+
+template <typename K>
+void
+DynamicMatrix<K>::print(const std::string& name) const {
+  std::cout << name << " = [" << std::endl;
+  for (size_t i = 0; i < rows_; i++) {
+    for (size_t j = 0; j < cols_; j++) {
+      std::cout << " " << at(i, j);
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "]" << std::endl;
+}
+
+template <typename K>
+template <typename F>
+void
+DynamicMatrix<K>::generate(F func) {
+  for (size_t i = 0; i < rows_; i++) {
+    for (size_t j = 0; j < cols_; j++) {
+      at(i, j) = func(i, j);
+    }
+  }
+}
+
+template <typename K>
+template <typename F>
+DynamicMatrix<K>
+DynamicMatrix<K>::apply(F func) const {
+  DynamicMatrix result(rows_, cols_);
+  for (size_t i = 0; i < size(); i++) {
+    result[i] = func(data_[i]);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename K>
+DynamicMatrix<K>
+operator+(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  DynamicMatrix<K> result(a);
+  return result += b;
+}
+
+template <typename K>
+DynamicMatrix<K>
+operator-(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  DynamicMatrix<K> result(a);
+  return result -= b;
+}
+
+// Element-wise (Hadamard) product
+template <typename K>
+DynamicMatrix<K>
+operator%(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  requireShape(a.rows() == b.rows() && a.cols() == b.cols(), "operator%: shapes differ");
+  DynamicMatrix<K> result(a.rows(), a.cols());
+  for (size_t i = 0; i < a.size(); i++) {
+    result[i] = a[i] * b[i];
+  }
+  return result;
+}
+
+// The same kernels as the fixed-size operator* (see Gemm.h)
+template <typename K>
+DynamicMatrix<K>
+operator*(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  requireShape(a.cols() == b.rows(), "operator*: inner dimensions differ");
+  DynamicMatrix<K> result(a.rows(), b.cols());
+  if (b.cols() == 1) {
+    gemm::gemv(a.rows(), a.cols(), (K)1, a.data(), a.cols(), b.data(), result.data());
+  } else {
+    gemm::multiply(a.rows(), b.cols(), a.cols(), (K)1,
+                   a.data(),      a.cols(), 1,
+                   b.data(),      b.cols(), 1,
+                   result.data(), b.cols(), 1);
+  }
+  return result;
+}
+
+// y = A * x
+template <typename K>
+DynamicMatrix<K>
+gemv(DynamicMatrix<K> const& a, DynamicMatrix<K> const& x) {
+  requireShape(x.rows() == a.cols() && x.cols() == 1, "gemv: x must be a column of A's width");
+  DynamicMatrix<K> result(a.rows(), 1);
+  gemm::gemv(a.rows(), a.cols(), (K)1, a.data(), a.cols(), x.data(), result.data());
+  return result;
+}
+
+// y = A' * x, reading A in place
+template <typename K>
+DynamicMatrix<K>
+gemv_t(DynamicMatrix<K> const& a, DynamicMatrix<K> const& x) {
+  requireShape(x.rows() == a.rows() && x.cols() == 1, "gemv_t: x must be a column of A's height");
+  DynamicMatrix<K> result(a.cols(), 1);
+  gemm::gemvT(a.rows(), a.cols(), (K)1, a.data(), a.cols(), x.data(), result.data());
+  return result;
+}
+
+template <typename K>
+bool
+operator==(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  return a.rows() == b.rows() && a.cols() == b.cols() && 
+         std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+template <typename K>
+bool
+operator!=(DynamicMatrix<K> const& a, DynamicMatrix<K> const& b) {
+  return !(a == b);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
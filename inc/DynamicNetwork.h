@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_DYNAMICNETWORK_H
+#define INCLUDED_DYNAMICNETWORK_H
+
+#ifndef INCLUDED_DYNAMICLAYER_H
+#include "DynamicLayer.h"
+#endif
+
+#include <vector>
+#include <sstream>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+
+// A feed-forward network of DynamicLayers, composed at run time.  It trains
+// just as FeedForwardNetwork does: the output layer learns its target, and
+// each layer below corrects by the error propagated back to it.
+struct DynamicNetwork {
+  typedef DynamicLayer::Batch Batch;
+
+  DynamicNetwork() {}
+
+  // Layers of the given sizes, e.g. {784, 350, 10}
+  explicit DynamicNetwork(const std::vector<size_t>& shape, 
+                          ActivationType activation = ActivationType::Sigmoid) {
+    for (size_t i = 1; i < shape.size(); i++) {
+      addLayer(DynamicLayer(shape[i - 1], shape[i], activation));
+    }
+  }
+
+  // Build a network from a description such as "784 350:sigmoid 10:linear" -
+  // the input size, then each layer's size with an optional activation 
+  // (sigmoid by default)
+  static DynamicNetwork
+  parse(const std::string& description) {
+    std::istringstream tokens(description);
+    std::string        token;
+    DynamicNetwork     network;
+    bool               first  = true;
+    size_t             inputs = 0;
+    while (tokens >> token) {
+      const size_t      colon = token.find(':');
+      const size_t      size  = std::stoul(token.substr(0, colon));
+      const std::string name  = colon == std::string::npos ? "sigmoid" : token.substr(colon + 1);
+      requireShape(size > 0, "DynamicNetwork::parse: sizes must be non-zero");
+      if (!first) {
+        network.addLayer(DynamicLayer(inputs, size, parseActivation(name)));
+      }
+      first  = false;
+      inputs = size;
+    }
+    requireShape(network.depth() > 0, "DynamicNetwork::parse: need an input size and at least one layer");
+    return network;
+  }
+
+  DynamicNetwork& 
+  addLayer(const DynamicLayer& layer) {
+    requireShape(layers_.empty() || layers_.back().outputs() == layer.inputs(), 
+                 "DynamicNetwork::addLayer: layer doesn't fit the previous one");
+    layers_.push_back(layer);
+    return *this;
+  }
+
+  size_t depth() const { return layers_.size(); }
+
+  Batch
+  infer(const Batch& input) const {
+    requireShape(!layers_.empty(), "DynamicNetwork::infer: no layers");
+    Batch next = input;
+    for (const auto& layer : layers_) {
+      next = layer.infer(next);
+    }
+    return next;
+  }
+
+  std::tuple<Batch, Batch>
+  learn(const Batch& input, const Batch& target, float learningRate = 0.1f) {
+    requireShape(!layers_.empty(), "DynamicNetwork::learn: no layers");
+
+    // Keep every layer's output for the backward pass
+    std::vector<Batch> outputs;
+    outputs.reserve(layers_.size() + 1);
+    outputs.push_back(input);
+    for (const auto& layer : layers_) {
+      outputs.push_back(layer.infer(outputs.back()));
+    }
+
+    const size_t last   = layers_.size() - 1;
+    auto         result = layers_[last].learn(outputs[last], outputs[last + 1], target, learningRate);
+    Batch        loss   = std::get<1>(result);
+    for (size_t i = last; i-- > 0; ) {
+      result = layers_[i].correct(outputs[i], outputs[i + 1], std::get<0>(result), learningRate);
+    }
+    return std::make_tuple(std::get<0>(result), loss);
+  }
+
+  DynamicLayer& getLayer(size_t i) {
+    return layers_[i];
+  }
+
+private:
+  std::vector<DynamicLayer> layers_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
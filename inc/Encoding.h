@@ -0,0 +1,343 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_ENCODING_H
+#define INCLUDED_ENCODING_H
+
+#ifndef INCLUDED_MATRIX_H
+#include "Matrix.h"
+#endif
+
+#ifndef INCLUDED_DYNAMICMATRIX_H
+#include "DynamicMatrix.h"
+#endif
+
+#ifndef INCLUDED_MEMORY_H
+#include "Memory.h"
+#endif
+
+#ifndef INCLUDED_IDXDATASET_H
+#include "IdxDataset.h"
+#endif
+
+#ifndef INCLUDED_SIMD_H
+#include "Simd.h"
+#endif
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <memory>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// How raw bytes become network inputs: feature p of a sample is encoded as
+// x*scale[p] + offset[p]
+struct Encoding {
+  std::vector<float> scale;
+  std::vector<float> offset;
+
+  // x/255, into [0, 1]
+  static Encoding 
+  unit(size_t features) {
+    Encoding e;
+    e.scale.assign(features, 1.0f/255.0f);
+    e.offset.assign(features, 0.0f);
+    return e;
+  }
+
+  // (x - mean)/stddev over count samples of features bytes each, with one
+  // mean and deviation per feature or (perFeature = false) one for all.  
+  // Features that never vary are just centred.
+  static Encoding
+  standardize(const uint8_t* samples, size_t count, size_t features, bool perFeature = true) {
+    requireShape(count > 0, "Encoding::standardize: no samples");
+    std::vector<double> sum(features, 0.0), squares(features, 0.0);
+    for (size_t s = 0; s < count; s++) {
+      for (size_t p = 0; p < features; p++) {
+        const double x = samples[s*features + p];
+        sum[p]     += x;
+        squares[p] += x*x;
+      }
+    }
+    if (!perFeature) {
+      double total = 0.0, totalSquares = 0.0;
+      for (size_t p = 0; p < features; p++) {
+        total        += sum[p];
+        totalSquares += squares[p];
+      }
+      sum.assign(features, total/features);
+      squares.assign(features, totalSquares/features);
+    }
+
+    Encoding e;
+    for (size_t p = 0; p < features; p++) {
+      const double mean     = sum[p]/count;
+      const double variance = std::max(0.0, squares[p]/count - mean*mean);
+      const double scale    = variance > 1.0e-12 ? 1.0/std::sqrt(variance) : 1.0;
+      e.scale.push_back((float)scale);
+      e.offset.push_back((float)(-mean*scale));
+    }
+    return e;
+  }
+};
+
+//------------------------------------------------------------------------------
+// Encode one sample into contiguous floats - e.g. a ColVector
+inline void
+encodeSample(const uint8_t* in, size_t features, const Encoding& e, float* out) {
+  size_t p = 0;
+#ifdef ROOK_AVX2
+  for (; p + 8 <= features; p += 8) {
+    const __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + p))));
+    _mm256_storeu_ps(out + p, _mm256_fmadd_ps(x, _mm256_loadu_ps(&e.scale[p]), _mm256_loadu_ps(&e.offset[p])));
+  }
+#endif
+  for (; p < features; p++) {
+    out[p] = in[p]*e.scale[p] + e.offset[p];
+  }
+}
+
+//------------------------------------------------------------------------------
+// Batches are column-blocked (see Layer::InputBatch): feature p of sample b
+// lives at out[p*ld + b], while samples arrive one contiguous row at a time,
+// so encoding a batch is a transpose.  Both routines below go 8 samples by
+// 8 features at a time, widening and scaling in registers and transposing
+// with shuffles, so every store is a whole row of 8 floats.
+#ifdef ROOK_AVX2
+inline void
+transpose8(__m256 r[8]) {
+  const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+  const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+  const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+  const __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44), s1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+  const __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44), s3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+  const __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44), s5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+  const __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44), s7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+  r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+  r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+  r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+  r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+  r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+  r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+  r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+  r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+inline __m256 load8(const uint8_t* p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)));
+}
+
+inline __m256 load8(const float* p) {
+  return _mm256_loadu_ps(p);
+}
+#endif
+
+// What happens to feature p on its way into a batch: scale*x + offset,
+// or nothing at all for samples that are already encoded
+struct ScaleOffset {
+  const float* scale;
+  const float* offset;
+
+  float operator()(float x, size_t p) const { 
+    return x*scale[p] + offset[p]; 
+  }
+#ifdef ROOK_AVX2
+  __m256 operator()(__m256 x, size_t p) const { 
+    return _mm256_fmadd_ps(x, _mm256_set1_ps(scale[p]), _mm256_set1_ps(offset[p])); 
+  }
+#endif
+};
+
+struct Unscaled {
+  float operator()(float x, size_t) const { 
+    return x; 
+  }
+#ifdef ROOK_AVX2
+  __m256 operator()(__m256 x, size_t) const { 
+    return x; 
+  }
+#endif
+};
+
+// Transpose count samples (samples[b] points at sample b) of features 
+// elements each into columns of out, through f.  T is uint8_t for raw 
+// bytes, or float for samples that are already encoded.
+template <typename T, typename F>
+void
+transposeSamples(const T* const* samples, size_t count, size_t features, 
+                 const F& f, float* out, size_t ld) {
+  size_t b = 0;
+#ifdef ROOK_AVX2
+  const size_t blockedSamples  = count/8*8;
+  const size_t blockedFeatures = features/8*8;
+  for (; b < blockedSamples; b += 8) {
+    size_t p = 0;
+    for (; p < blockedFeatures; p += 8) {
+      __m256 r[8];
+      for (size_t k = 0; k < 8; k++) {
+        r[k] = load8(samples[b + k] + p);
+      }
+      transpose8(r);
+      for (size_t k = 0; k < 8; k++) {
+        _mm256_storeu_ps(out + (p + k)*ld + b, f(r[k], p + k));
+      }
+    }
+    for (; p < features; p++) {
+      for (size_t k = 0; k < 8; k++) {
+        out[p*ld + b + k] = f((float)samples[b + k][p], p);
+      }
+    }
+  }
+#endif
+  for (; b < count; b++) {
+    for (size_t p = 0; p < features; p++) {
+      out[p*ld + b] = f((float)samples[b][p], p);
+    }
+  }
+}
+
+// As scale*x + offset
+template <typename T>
+void
+transposeSamples(const T* const* samples, size_t count, size_t features, 
+                 const float* scale, const float* offset, float* out, size_t ld) {
+  transposeSamples(samples, count, features, ScaleOffset{scale, offset}, out, ld);
+}
+
+// As is
+template <typename T>
+void
+transposeSamples(const T* const* samples, size_t count, size_t features, float* out, size_t ld) {
+  transposeSamples(samples, count, features, Unscaled(), out, ld);
+}
+
+// Encode count byte samples into columns of out (leading dimension ld)
+inline void
+encodeBatch(const uint8_t* const* samples, size_t count, size_t features, 
+            const Encoding& e, float* out, size_t ld) {
+  transposeSamples(samples, count, features, e.scale.data(), e.offset.data(), out, ld);
+}
+
+// Encode B consecutive samples, each stride bytes apart, into a batch
+template <size_t X, size_t B, typename S>
+void
+encodeBatch(const uint8_t* first, size_t stride, const Encoding& e, Matrix<X, B, float, S>& out) {
+  requireShape(e.scale.size() == X && e.offset.size() == X, "encodeBatch: encoding and batch sizes differ");
+  std::array<const uint8_t*, B> samples;
+  for (size_t b = 0; b < B; b++) {
+    samples[b] = first + b*stride;
+  }
+  encodeBatch(samples.data(), B, X, e, out.raw().data(), B);
+}
+
+// Encode the samples indices[0] ... indices[B - 1], each stride bytes
+// apart from the one before, into a batch - e.g. in EpochSampler order
+template <size_t X, size_t B, typename S>
+void
+gatherBatch(const uint8_t* samples, size_t stride, const size_t* indices, 
+            const Encoding& e, Matrix<X, B, float, S>& out) {
+  requireShape(e.scale.size() == X && e.offset.size() == X, "gatherBatch: encoding and batch sizes differ");
+  std::array<const uint8_t*, B> gathered;
+  for (size_t b = 0; b < B; b++) {
+    gathered[b] = samples + indices[b]*stride;
+  }
+  encodeBatch(gathered.data(), B, X, e, out.raw().data(), B);
+}
+
+//------------------------------------------------------------------------------
+// A whole dataset encoded once, up front: sample i is features contiguous,
+// cache-line aligned floats.  Single samples can be used in place, and 
+// batches are gathered (in any order) with the same transposes as above.
+struct FloatArena {
+  FloatArena(const uint8_t* samples, size_t count, size_t features, const Encoding& e)
+  : FloatArena(count, features) {
+    requireShape(e.scale.size() == features && e.offset.size() == features, 
+                 "FloatArena: encoding and sample sizes differ");
+    for (size_t i = 0; i < count; i++) {
+      encodeSample(samples + i*features, features, e, sample(i));
+    }
+  }
+
+  // Room for count samples, to be filled in.  With a path, the arena is a
+  // new file mapped shared, so one too big for memory pages out to disk.
+  FloatArena(size_t count, size_t features, const std::string& path = "")
+  : count_    (count)
+  , features_ (features)
+  , stride_   ((features + 15)/16*16) {
+    if (path.empty()) {
+      memory_ = AlignedArray<float>(count*stride_);
+      data_   = memory_.data();
+    } else {
+      file_.reset(new MappedFile(MappedFile::create(path, count*stride_*sizeof(float))));
+      data_   = reinterpret_cast<float*>(file_->data());
+    }
+  }
+
+  size_t size()     const { return count_; }
+  size_t features() const { return features_; }
+
+  const float* sample(size_t i) const {
+    return data_ + i*stride_;
+  }
+
+  float* sample(size_t i) {
+    return data_ + i*stride_;
+  }
+
+  // Gather the samples indices[0] ... indices[B - 1] into a batch
+  template <size_t X, size_t B, typename S>
+  void gather(const size_t* indices, Matrix<X, B, float, S>& out) const {
+    requireShape(features_ == X, "FloatArena::gather: arena and batch sizes differ");
+    std::array<const float*, B> samples;
+    for (size_t b = 0; b < B; b++) {
+      samples[b] = sample(indices[b]);
+    }
+    transposeSamples(samples.data(), B, X, out.raw().data(), B);
+  }
+
+private:
+  size_t                      count_;
+  size_t                      features_;
+  size_t                      stride_;
+  float*                      data_;
+  AlignedArray<float>         memory_;
+  std::unique_ptr<MappedFile> file_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,232 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_EXPRESSION_H
+#define INCLUDED_EXPRESSION_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Lazy element-wise arithmetic.  Sums, differences, Hadamard products and 
+// apply() build a small tree of expression nodes instead of a Matrix; the 
+// whole tree is evaluated in a single loop when it is finally assigned to a
+// Matrix.  So
+//
+//   Output out = (t - y).apply(f);
+//
+// makes one pass over memory and no temporaries.  Since t - y is not itself
+// a Matrix, functions that deduce their parameters from a Matrix (operator*,
+// for one) need it assigned to a Matrix first.
+//
+// Every node (and Matrix itself) derives from Expression<Derived>, and 
+// exposes rows, cols, Field and operator[] over its M*N elements in 
+// row-major order.
+template <typename Derived>
+struct Expression {
+  const Derived& derived() const { 
+    return static_cast<const Derived&>(*this); 
+  }
+
+  template <typename F>
+  struct Applied;
+
+  // Apply func to every element of this expression (lazily).  Large 
+  // expressions are evaluated across the thread pool only when func 
+  // captures nothing, or is marked pure() - so it may then be called 
+  // concurrently and in any order.  Anything else, including lambdas that
+  // capture and std::function, is evaluated serially (see IsConcurrent).
+  template <typename F>
+  typename Applied<F>::type
+  apply(F func) const & {
+    return typename Applied<F>::type(derived(), func);
+  }
+
+  template <typename F>
+  typename Applied<F>::moved
+  apply(F func) && {
+    return typename Applied<F>::moved(std::move(static_cast<Derived&>(*this)), func);
+  }
+};
+
+template <typename T>
+struct IsExpression 
+: std::is_base_of<Expression<typename std::decay<T>::type>, 
+                  typename std::decay<T>::type> {};
+
+//------------------------------------------------------------------------------
+// How a node holds its operands.  Named matrices are held by reference, and
+// everything else - other nodes, and temporaries that would otherwise 
+// dangle - by value (temporary matrices are moved in).
+template <typename T>
+struct IsLeaf : std::false_type {};
+
+template <typename T>
+struct Hold {
+  typedef typename std::decay<T>::type Type;
+  typedef typename std::conditional<
+    IsLeaf<Type>::value && std::is_lvalue_reference<T>::value, 
+    const Type&, 
+    Type
+  >::type type;
+};
+
+//------------------------------------------------------------------------------
+
+template <typename Op, typename L, typename R>
+struct BinaryExpression : Expression<BinaryExpression<Op, L, R>> {
+  typedef typename std::decay<L>::type Left;
+  typedef typename std::decay<R>::type Right;
+  typedef typename Left::Field         Field;
+  static const size_t rows = Left::rows;
+  static const size_t cols = Left::cols;
+
+  static_assert(Left::rows == Right::rows && Left::cols == Right::cols, 
+                "element-wise operands must have the same shape");
+
+  template <typename A, typename B>
+  BinaryExpression(A&& left, B&& right) 
+  : left_(std::forward<A>(left)), right_(std::forward<B>(right)) {}
+
+  Field operator[](size_t i) const {
+    return Op::apply(left_[i], right_[i]);
+  }
+
+private:
+  L left_;
+  R right_;
+};
+
+template <typename F, typename E>
+struct UnaryExpression : Expression<UnaryExpression<F, E>> {
+  typedef typename std::decay<E>::type Inner;
+  typedef typename Inner::Field        Field;
+  static const size_t rows = Inner::rows;
+  static const size_t cols = Inner::cols;
+
+  template <typename A>
+  UnaryExpression(A&& inner, F func) 
+  : inner_(std::forward<A>(inner)), func_(func) {}
+
+  Field operator[](size_t i) const {
+    return func_(inner_[i]);
+  }
+
+private:
+  E inner_;
+  F func_;
+};
+
+// apply() on a named Matrix refers to the Matrix, and anything else is 
+// copied (or moved) into the new node
+template <typename Derived>
+template <typename F>
+struct Expression<Derived>::Applied {
+  typedef UnaryExpression<F, typename Hold<const Derived&>::type> type;
+  typedef UnaryExpression<F, Derived>                             moved;
+};
+
+//------------------------------------------------------------------------------
+// A callable its author vouches is pure - e.g. a lambda capturing a 
+// learning rate by value - so apply() may run it on several threads at once
+template <typename F>
+struct Pure {
+  F func;
+
+  template <typename K>
+  K operator()(K x) const { 
+    return func(x); 
+  }
+};
+
+template <typename F>
+Pure<F>
+pure(F func) {
+  return Pure<F>{func};
+}
+
+template <typename F>
+struct IsPure : std::false_type {};
+
+template <typename F>
+struct IsPure<Pure<F>> : std::true_type {};
+
+//------------------------------------------------------------------------------
+// Whether an expression may be evaluated by several threads at once.  
+// Matrices and arithmetic nodes can be; apply() nodes can be if their 
+// callable is marked pure(), or is a function object with no state at all
+// (a lambda that captures nothing).  Anything that captures, by reference 
+// or by value, may write to what it holds, so is evaluated serially.
+template <typename T>
+struct IsConcurrent : std::true_type {};
+
+template <typename Op, typename L, typename R>
+struct IsConcurrent<BinaryExpression<Op, L, R>> 
+: std::integral_constant<bool, IsConcurrent<typename std::decay<L>::type>::value && 
+                               IsConcurrent<typename std::decay<R>::type>::value> {};
+
+template <typename F, typename E>
+struct IsConcurrent<UnaryExpression<F, E>> 
+: std::integral_constant<bool, (IsPure<F>::value || (std::is_class<F>::value && std::is_empty<F>::value)) &&
+                               IsConcurrent<typename std::decay<E>::type>::value> {};
+
+//------------------------------------------------------------------------------
+
+struct Add      { template <typename K> static K apply(K a, K b) { return a + b; } };
+struct Subtract { template <typename K> static K apply(K a, K b) { return a - b; } };
+struct Hadamard { template <typename K> static K apply(K a, K b) { return a * b; } };
+
+template <typename Op, typename A, typename B>
+struct Binary {
+  typedef BinaryExpression<Op, typename Hold<A>::type, typename Hold<B>::type> type;
+};
+
+#define ROOK_BINARY_OPERATOR(op, Op)                                          \
+template <typename A, typename B>                                             \
+typename std::enable_if<IsExpression<A>::value && IsExpression<B>::value,    \
+                        typename Binary<Op, A, B>::type>::type                \
+operator op(A&& a, B&& b) {                                                   \
+  return typename Binary<Op, A, B>::type(std::forward<A>(a), std::forward<B>(b)); \
+}
+
+ROOK_BINARY_OPERATOR(+, Add)
+ROOK_BINARY_OPERATOR(-, Subtract)
+ROOK_BINARY_OPERATOR(%, Hadamard)
+
+#undef ROOK_BINARY_OPERATOR
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
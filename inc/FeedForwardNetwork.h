@@ -51,6 +51,26 @@ struct FeedForwardNetwork {
   typedef typename FeedForwardNetwork<HiddenLayers...>::Output Output;
   typedef typename InputLayer::Input                           Input;
 
+  template <size_t B> using InputBatch  = typename InputLayer::template InputBatch<B>;
+  template <size_t B> using OutputBatch = typename FeedForwardNetwork<HiddenLayers...>::template OutputBatch<B>;
+
+  // Gradients for every layer, in network order
+  struct Gradient {
+    typename InputLayer::Gradient                          layer;
+    typename FeedForwardNetwork<HiddenLayers...>::Gradient remain;
+
+    Gradient& operator+=(const Gradient& other) {
+      layer  += other.layer;
+      remain += other.remain;
+      return *this;
+    }
+
+    void clear() {
+      layer.clear();
+      remain.clear();
+    }
+  };
+
   // Initialize network (default)
   FeedForwardNetwork()
   : pHiddenLayers_(new FeedForwardNetwork<HiddenLayers...>()) {
@@ -64,25 +84,68 @@ struct FeedForwardNetwork {
     return pHiddenLayers_->infer(next);
   }
 
+  // Forward pass for B samples at once (one per column), one GEMM per layer
+  template <size_t B>
+  OutputBatch<B>
+  inferBatch(const InputBatch<B>& input) const {
+    const auto next = inputLayer_.inferBatch(input);
+    return pHiddenLayers_->inferBatch(next);
+  }
+
   std::tuple<Input, Output>
   learn(const Input& input, const Output& target, float learningRate = 0.1f) {
     // Calculate the output of this layer
     const auto next   = inputLayer_.infer(input);
-    const auto herror = pHiddenLayers_->learn(next, target);
+    const auto herror = pHiddenLayers_->learn(next, target, learningRate);
 
     // This is turd
-    const auto error  = inputLayer_.correct(input, next, std::get<0>(herror));
+    const auto error  = inputLayer_.correct(input, next, std::get<0>(herror), learningRate);
+    return std::make_tuple(std::get<0>(error), std::get<1>(herror));
+  }
+
+  // Learn from B samples at once, with a single weight update per layer
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  learnBatch(const InputBatch<B>& input, const OutputBatch<B>& target, float learningRate = 0.1f) {
+    const auto next   = inputLayer_.inferBatch(input);
+    const auto herror = pHiddenLayers_->learnBatch(next, target, learningRate);
+    const auto error  = inputLayer_.correctBatch(input, next, std::get<0>(herror), learningRate);
     return std::make_tuple(std::get<0>(error), std::get<1>(herror));
   }
 
+  // Accumulate the gradient of every layer for a batch, leaving the 
+  // weights alone
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  gradientBatch(const InputBatch<B>& input, const OutputBatch<B>& target, Gradient& gradient) const {
+    const auto next   = inputLayer_.inferBatch(input);
+    const auto herror = pHiddenLayers_->gradientBatch(next, target, gradient.remain);
+    const typename InputLayer::template OutputBatch<B> ntarget = next + std::get<0>(herror);
+    const auto error  = inputLayer_.gradientBatch(input, next, ntarget, gradient.layer);
+    return std::make_tuple(std::get<0>(error), std::get<1>(herror));
+  }
+
+  void apply(const Gradient& gradient, float rate) {
+    inputLayer_.apply(gradient.layer, rate);
+    pHiddenLayers_->apply(gradient.remain, rate);
+  }
+
   InputLayer& getLayer() {
     return inputLayer_;
   }
 
+  const InputLayer& getLayer() const {
+    return inputLayer_;
+  }
+
   FeedForwardNetwork<HiddenLayers...>& getRemainNetwork() {
     return *pHiddenLayers_;
   }
 
+  const FeedForwardNetwork<HiddenLayers...>& getRemainNetwork() const {
+    return *pHiddenLayers_;
+  }
+
 private:
   std::unique_ptr<FeedForwardNetwork<HiddenLayers...>> pHiddenLayers_;
   InputLayer                                           inputLayer_;
@@ -94,11 +157,22 @@ struct FeedForwardNetwork<OutputLayer> {
   typedef typename OutputLayer::Output Output;
   typedef typename OutputLayer::Input  Input;
 
+  template <size_t B> using InputBatch  = typename OutputLayer::template InputBatch<B>;
+  template <size_t B> using OutputBatch = typename OutputLayer::template OutputBatch<B>;
+
+  typedef typename OutputLayer::Gradient Gradient;
+
   Output
   infer(const Input& input) const {
     return outputLayer_.infer(input);
   }
 
+  template <size_t B>
+  OutputBatch<B>
+  inferBatch(const InputBatch<B>& input) const {
+    return outputLayer_.inferBatch(input);
+  }
+
   std::tuple<Input, Output>
   learn(const Input& input, const Output& target, float learningRate = 0.1f) {
     // The input to the final layer is input, 
@@ -107,16 +181,38 @@ struct FeedForwardNetwork<OutputLayer> {
     const auto prediction = infer(input);
 
     // Update our output weights and get our errors
-    const auto error      = outputLayer_.learn(input, prediction, target);
+    const auto error      = outputLayer_.learn(input, prediction, target, learningRate);
 
     // Back propagate our error
     return error;
   }
 
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  learnBatch(const InputBatch<B>& input, const OutputBatch<B>& target, float learningRate = 0.1f) {
+    const auto prediction = outputLayer_.inferBatch(input);
+    return outputLayer_.learnBatch(input, prediction, target, learningRate);
+  }
+
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  gradientBatch(const InputBatch<B>& input, const OutputBatch<B>& target, Gradient& gradient) const {
+    const auto prediction = outputLayer_.inferBatch(input);
+    return outputLayer_.gradientBatch(input, prediction, target, gradient);
+  }
+
+  void apply(const Gradient& gradient, float rate) {
+    outputLayer_.apply(gradient, rate);
+  }
+
   OutputLayer& getLayer() { 
     return outputLayer_;
   }
 
+  const OutputLayer& getLayer() const { 
+    return outputLayer_;
+  }
+
 private:
   OutputLayer outputLayer_;
 };
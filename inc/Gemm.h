@@ -0,0 +1,696 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_GEMM_H
+#define INCLUDED_GEMM_H
+
+#include <cstddef>
+#include <algorithm>
+
+#ifndef INCLUDED_MEMORY_H
+#include "Memory.h"
+#endif
+
+#ifndef INCLUDED_THREADPOOL_H
+#include "ThreadPool.h"
+#endif
+
+#ifndef INCLUDED_SIMD_H
+#include "Simd.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace rook {
+namespace gemm {
+
+//------------------------------------------------------------------------------
+// Single precision GEMM, in the spirit of GotoBLAS/BLIS:
+//
+//   C (m x n) += alpha * A (m x k) * B (k x n)
+//
+// Every operand is described by a base pointer and a row and column stride,
+// so transposed operands are free - just swap the strides.  B is packed into
+// KC x NC panels (sized for L2/L3), A into MC x KC panels (sized for L2), and
+// a register-tiled MR x NR micro-kernel streams through the packed panels out
+// of L1.
+//
+#ifdef ROOK_AVX2
+const size_t MR = 6;
+const size_t NR = 16;
+#else
+const size_t MR = 4;
+const size_t NR = 8;
+#endif
+
+const size_t MC = 120;
+const size_t KC = 256;
+const size_t NC = 3072;
+
+//------------------------------------------------------------------------------
+// Packing buffers are per-thread and cache-line aligned, and grow to fit
+// the largest panel seen
+inline float*
+packBuffer(AlignedArray<float>& buffer, size_t size) {
+  buffer.reserve(size);
+  return buffer.data();
+}
+
+// Pack an mc x kc block of A into MR-row slivers, column by column.  Rows
+// past the edge are zero-padded so the micro-kernel never has to branch.
+inline void
+packA(size_t mc, size_t kc, const float* a, ptrdiff_t rsa, ptrdiff_t csa, float* packed) {
+  for (size_t i = 0; i < mc; i += MR) {
+    const size_t mr = std::min(MR, mc - i);
+    for (size_t p = 0; p < kc; p++) {
+      for (size_t r = 0; r < mr; r++) {
+        packed[r] = a[(i + r)*rsa + p*csa];
+      }
+      for (size_t r = mr; r < MR; r++) {
+        packed[r] = 0.0f;
+      }
+      packed += MR;
+    }
+  }
+}
+
+// Pack a kc x nc block of B into NR-column slivers, row by row
+inline void
+packB(size_t kc, size_t nc, const float* b, ptrdiff_t rsb, ptrdiff_t csb, float* packed) {
+  for (size_t j = 0; j < nc; j += NR) {
+    const size_t nr = std::min(NR, nc - j);
+    for (size_t p = 0; p < kc; p++) {
+      const float* row = b + p*rsb + j*csb;
+      if (csb == 1) {
+        std::copy(row, row + nr, packed);
+      } else {
+        for (size_t c = 0; c < nr; c++) {
+          packed[c] = row[c*csb];
+        }
+      }
+      for (size_t c = nr; c < NR; c++) {
+        packed[c] = 0.0f;
+      }
+      packed += NR;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Micro-kernels: C (MR x NR, row stride rsc, unit column stride) +=
+// alpha * Apanel * Bpanel.  Each B sliver is one aligned cache line per k.
+#ifdef ROOK_AVX2
+inline void
+microKernel(size_t kc, float alpha, const float* a, const float* b, float* c, ptrdiff_t rsc) {
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+  __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+  for (size_t p = 0; p < kc; p++) {
+    const __m256 b0 = _mm256_load_ps(b);
+    const __m256 b1 = _mm256_load_ps(b + 8);
+    __m256 ar;
+    ar = _mm256_broadcast_ss(a + 0);
+    c00 = _mm256_fmadd_ps(ar, b0, c00); c01 = _mm256_fmadd_ps(ar, b1, c01);
+    ar = _mm256_broadcast_ss(a + 1);
+    c10 = _mm256_fmadd_ps(ar, b0, c10); c11 = _mm256_fmadd_ps(ar, b1, c11);
+    ar = _mm256_broadcast_ss(a + 2);
+    c20 = _mm256_fmadd_ps(ar, b0, c20); c21 = _mm256_fmadd_ps(ar, b1, c21);
+    ar = _mm256_broadcast_ss(a + 3);
+    c30 = _mm256_fmadd_ps(ar, b0, c30); c31 = _mm256_fmadd_ps(ar, b1, c31);
+    ar = _mm256_broadcast_ss(a + 4);
+    c40 = _mm256_fmadd_ps(ar, b0, c40); c41 = _mm256_fmadd_ps(ar, b1, c41);
+    ar = _mm256_broadcast_ss(a + 5);
+    c50 = _mm256_fmadd_ps(ar, b0, c50); c51 = _mm256_fmadd_ps(ar, b1, c51);
+    a += MR;
+    b += NR;
+  }
+
+  const __m256 va = _mm256_set1_ps(alpha);
+#define ROOK_STORE_ROW(r, lo, hi) \
+  _mm256_storeu_ps(c + r*rsc,     _mm256_fmadd_ps(va, lo, _mm256_loadu_ps(c + r*rsc))); \
+  _mm256_storeu_ps(c + r*rsc + 8, _mm256_fmadd_ps(va, hi, _mm256_loadu_ps(c + r*rsc + 8)));
+  ROOK_STORE_ROW(0, c00, c01)
+  ROOK_STORE_ROW(1, c10, c11)
+  ROOK_STORE_ROW(2, c20, c21)
+  ROOK_STORE_ROW(3, c30, c31)
+  ROOK_STORE_ROW(4, c40, c41)
+  ROOK_STORE_ROW(5, c50, c51)
+#undef ROOK_STORE_ROW
+}
+#else
+// Portable fallback - small enough for the compiler to keep the tile in
+// registers and vectorize across NR
+inline void
+microKernel(size_t kc, float alpha, const float* a, const float* b, float* c, ptrdiff_t rsc) {
+  float acc[MR][NR] = {{0.0f}};
+  for (size_t p = 0; p < kc; p++) {
+    for (size_t r = 0; r < MR; r++) {
+      for (size_t j = 0; j < NR; j++) {
+        acc[r][j] += a[r] * b[j];
+      }
+    }
+    a += MR;
+    b += NR;
+  }
+  for (size_t r = 0; r < MR; r++) {
+    for (size_t j = 0; j < NR; j++) {
+      c[r*rsc + j] += alpha * acc[r][j];
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Multiply packed panels: C (mc x nc) += alpha * Apacked * Bpacked.  Partial
+// tiles on the right and bottom edges go through a scratch tile.
+inline void
+macroKernel(size_t mc, size_t nc, size_t kc, float alpha,
+            const float* a, const float* b,
+            float* c, ptrdiff_t rsc, ptrdiff_t csc) {
+  float tile[MR*NR];
+  for (size_t j = 0; j < nc; j += NR) {
+    const size_t nr = std::min(NR, nc - j);
+    for (size_t i = 0; i < mc; i += MR) {
+      const size_t mr = std::min(MR, mc - i);
+      const float* ap = a + i*kc;
+      const float* bp = b + j*kc;
+      float*       cp = c + i*rsc + j*csc;
+
+      if (mr == MR && nr == NR && csc == 1) {
+        microKernel(kc, alpha, ap, bp, cp, rsc);
+      } else {
+        std::fill(tile, tile + MR*NR, 0.0f);
+        microKernel(kc, alpha, ap, bp, tile, NR);
+        for (size_t r = 0; r < mr; r++) {
+          for (size_t s = 0; s < nr; s++) {
+            cp[r*rsc + s*csc] += tile[r*NR + s];
+          }
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// C += alpha * A * B, with arbitrary strides for each operand
+inline void
+gemm(size_t m, size_t n, size_t k, float alpha,
+     const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+     const float* b, ptrdiff_t rsb, ptrdiff_t csb,
+     float*       c, ptrdiff_t rsc, ptrdiff_t csc) {
+  static thread_local AlignedArray<float> bufferA, bufferB;
+  float* packedA = packBuffer(bufferA, MC*KC);
+  float* packedB = packBuffer(bufferB, KC*(NC + NR));
+
+  for (size_t jc = 0; jc < n; jc += NC) {
+    const size_t nc = std::min(NC, n - jc);
+    for (size_t pc = 0; pc < k; pc += KC) {
+      const size_t kc = std::min(KC, k - pc);
+      packB(kc, nc, b + pc*rsb + jc*csb, rsb, csb, packedB);
+      for (size_t ic = 0; ic < m; ic += MC) {
+        const size_t mc = std::min(MC, m - ic);
+        packA(mc, kc, a + ic*rsa + pc*csa, rsa, csa, packedA);
+        macroKernel(mc, nc, kc, alpha, packedA, packedB,
+                    c + ic*rsc + jc*csc, rsc, csc);
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Straightforward C += alpha * A * B for small or skinny products, where
+// packing costs more than it saves.  The i-k-j order keeps the innermost
+// loop contiguous in both B and C for row-major operands.
+template <typename K>
+void
+naive(size_t m, size_t n, size_t k, K alpha,
+      const K* a, ptrdiff_t rsa, ptrdiff_t csa,
+      const K* b, ptrdiff_t rsb, ptrdiff_t csb,
+      K*       c, ptrdiff_t rsc, ptrdiff_t csc) {
+  for (size_t i = 0; i < m; i++) {
+    for (size_t p = 0; p < k; p++) {
+      const K aip = alpha * a[i*rsa + p*csa];
+      for (size_t j = 0; j < n; j++) {
+        c[i*rsc + j*csc] += aip * b[p*rsb + j*csb];
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Skinny products (a handful of columns, e.g. a small inference batch).
+// Packing A would cost more than the whole multiply, so A is streamed once
+// in place, R rows by W vectors of columns at a time, while the narrow B
+// stays in L1.  The last vector of each row is masked, so any width works.
+// B and C must have unit column stride.
+#ifdef ROOK_AVX2
+const size_t SKINNY = 32;
+
+template <size_t R, size_t W>
+inline void
+skinnyTile(size_t k, float alpha,
+           const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+           const float* b, ptrdiff_t rsb, __m256i mask,
+           float*       c, ptrdiff_t rsc) {
+  __m256 acc[R][W];
+  for (size_t r = 0; r < R; r++) {
+    for (size_t w = 0; w < W; w++) {
+      acc[r][w] = _mm256_setzero_ps();
+    }
+  }
+
+  for (size_t p = 0; p < k; p++) {
+    __m256 bv[W];
+    for (size_t w = 0; w + 1 < W; w++) {
+      bv[w] = _mm256_loadu_ps(b + p*rsb + 8*w);
+    }
+    bv[W - 1] = _mm256_maskload_ps(b + p*rsb + 8*(W - 1), mask);
+    for (size_t r = 0; r < R; r++) {
+      const __m256 ar = _mm256_broadcast_ss(a + r*rsa + p*csa);
+      for (size_t w = 0; w < W; w++) {
+        acc[r][w] = _mm256_fmadd_ps(ar, bv[w], acc[r][w]);
+      }
+    }
+  }
+
+  const __m256 va = _mm256_set1_ps(alpha);
+  for (size_t r = 0; r < R; r++) {
+    float* cr = c + r*rsc;
+    for (size_t w = 0; w + 1 < W; w++) {
+      _mm256_storeu_ps(cr + 8*w, _mm256_fmadd_ps(va, acc[r][w], _mm256_loadu_ps(cr + 8*w)));
+    }
+    float* cw = cr + 8*(W - 1);
+    _mm256_maskstore_ps(cw, mask, _mm256_fmadd_ps(va, acc[r][W - 1], _mm256_maskload_ps(cw, mask)));
+  }
+}
+
+template <size_t W>
+inline void
+skinnyPanel(size_t m, size_t k, float alpha,
+            const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+            const float* b, ptrdiff_t rsb, __m256i mask,
+            float*       c, ptrdiff_t rsc) {
+  const size_t m4 = m - m%4;
+  for (size_t i = 0; i < m4; i += 4) {
+    skinnyTile<4, W>(k, alpha, a + i*rsa, rsa, csa, b, rsb, mask, c + i*rsc, rsc);
+  }
+  for (size_t i = m4; i < m; i++) {
+    skinnyTile<1, W>(k, alpha, a + i*rsa, rsa, csa, b, rsb, mask, c + i*rsc, rsc);
+  }
+}
+
+inline void
+skinny(size_t m, size_t n, size_t k, float alpha,
+       const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+       const float* b, ptrdiff_t rsb,
+       float*       c, ptrdiff_t rsc) {
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (size_t j = 0; j < n; j += 16) {
+    const size_t  cols = std::min<size_t>(16, n - j);
+    const size_t  last = cols > 8 ? cols - 8 : cols;
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)last), lanes);
+    if (cols > 8) {
+      skinnyPanel<2>(m, k, alpha, a, rsa, csa, b + j, rsb, mask, c + j, rsc);
+    } else {
+      skinnyPanel<1>(m, k, alpha, a, rsa, csa, b + j, rsb, mask, c + j, rsc);
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// The same choice as Multiply (below), made at run time for strided
+// operands: C += alpha * A * B
+inline void
+multiplyKernel(size_t m, size_t n, size_t k, float alpha,
+         const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+         const float* b, ptrdiff_t rsb, ptrdiff_t csb,
+         float*       c, ptrdiff_t rsc, ptrdiff_t csc) {
+#ifdef ROOK_AVX2
+  if (n > 1 && n < SKINNY && csb == 1 && csc == 1) {
+    skinny(m, n, k, alpha, a, rsa, csa, b, rsb, c, rsc);
+    return;
+  }
+#endif
+  if (m >= MR && n >= NR/2 && m*n*k >= 32*32*32) {
+    gemm(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+  } else {
+    naive<float>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+  }
+}
+
+// Other element types take the straightforward route
+template <typename K>
+void
+multiply(size_t m, size_t n, size_t k, K alpha,
+         const K* a, ptrdiff_t rsa, ptrdiff_t csa,
+         const K* b, ptrdiff_t rsb, ptrdiff_t csb,
+         K*       c, ptrdiff_t rsc, ptrdiff_t csc) {
+  naive<K>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+}
+
+// Large products are split by rows of C across the shared pool, in whole
+// micro-tiles
+inline void
+multiply(size_t m, size_t n, size_t k, float alpha,
+         const float* a, ptrdiff_t rsa, ptrdiff_t csa,
+         const float* b, ptrdiff_t rsb, ptrdiff_t csb,
+         float*       c, ptrdiff_t rsc, ptrdiff_t csc) {
+  parallelFor(m, MR, m*n*k, [=](size_t begin, size_t end) {
+    multiplyKernel(end - begin, n, k, alpha, 
+                   a + begin*rsa, rsa, csa, 
+                   b,             rsb, csb, 
+                   c + begin*rsc, rsc, csc);
+  });
+}
+
+//------------------------------------------------------------------------------
+// Matrix-vector products over a row-major A (m x n, leading dimension lda).
+// Neither kernel ever forms A' - gemvT walks the rows of A and scatters
+// into y instead.
+//
+//   gemv  : y (m) += alpha * A  * x (n)
+//   gemvT : y (n) += alpha * A' * x (m)
+//
+// The kernels do the work on one thread; gemv and gemvT (below) split
+// large products across the shared pool.
+template <typename K>
+void
+gemvKernel(size_t m, size_t n, K alpha, const K* a, size_t lda, const K* x, K* y) {
+  for (size_t i = 0; i < m; i++) {
+    K sum = (K)0;
+    for (size_t j = 0; j < n; j++) {
+      sum += a[i*lda + j] * x[j];
+    }
+    y[i] += alpha * sum;
+  }
+}
+
+template <typename K>
+void
+gemvTKernel(size_t m, size_t n, K alpha, const K* a, size_t lda, const K* x, K* y) {
+  for (size_t i = 0; i < m; i++) {
+    const K axi = alpha * x[i];
+    for (size_t j = 0; j < n; j++) {
+      y[j] += axi * a[i*lda + j];
+    }
+  }
+}
+
+#ifdef ROOK_AVX2
+inline float
+hsum(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+// Four rows at a time, so each load of x feeds four FMAs
+inline void
+gemvKernel(size_t m, size_t n, float alpha, const float* a, size_t lda, const float* x, float* y) {
+  const size_t m4 = m - m%4;
+  const size_t n8 = n - n%8;
+  for (size_t i = 0; i < m4; i += 4) {
+    const float* a0 = a + (i + 0)*lda;
+    const float* a1 = a + (i + 1)*lda;
+    const float* a2 = a + (i + 2)*lda;
+    const float* a3 = a + (i + 3)*lda;
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    for (size_t j = 0; j < n8; j += 8) {
+      const __m256 xv = _mm256_loadu_ps(x + j);
+      s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a0 + j), xv, s0);
+      s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a1 + j), xv, s1);
+      s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a2 + j), xv, s2);
+      s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a3 + j), xv, s3);
+    }
+    float t0 = hsum(s0), t1 = hsum(s1), t2 = hsum(s2), t3 = hsum(s3);
+    for (size_t j = n8; j < n; j++) {
+      t0 += a0[j] * x[j];
+      t1 += a1[j] * x[j];
+      t2 += a2[j] * x[j];
+      t3 += a3[j] * x[j];
+    }
+    y[i + 0] += alpha * t0;
+    y[i + 1] += alpha * t1;
+    y[i + 2] += alpha * t2;
+    y[i + 3] += alpha * t3;
+  }
+  for (size_t i = m4; i < m; i++) {
+    const float* ai = a + i*lda;
+    __m256 s = _mm256_setzero_ps();
+    for (size_t j = 0; j < n8; j += 8) {
+      s = _mm256_fmadd_ps(_mm256_loadu_ps(ai + j), _mm256_loadu_ps(x + j), s);
+    }
+    float t = hsum(s);
+    for (size_t j = n8; j < n; j++) {
+      t += ai[j] * x[j];
+    }
+    y[i] += alpha * t;
+  }
+}
+
+// Four rows at a time, so each load/store of y absorbs four rows of A
+inline void
+gemvTKernel(size_t m, size_t n, float alpha, const float* a, size_t lda, const float* x, float* y) {
+  const size_t m4 = m - m%4;
+  const size_t n8 = n - n%8;
+  for (size_t i = 0; i < m4; i += 4) {
+    const float* a0 = a + (i + 0)*lda;
+    const float* a1 = a + (i + 1)*lda;
+    const float* a2 = a + (i + 2)*lda;
+    const float* a3 = a + (i + 3)*lda;
+    const float  x0 = alpha * x[i + 0], x1 = alpha * x[i + 1];
+    const float  x2 = alpha * x[i + 2], x3 = alpha * x[i + 3];
+    const __m256 v0 = _mm256_set1_ps(x0), v1 = _mm256_set1_ps(x1);
+    const __m256 v2 = _mm256_set1_ps(x2), v3 = _mm256_set1_ps(x3);
+    for (size_t j = 0; j < n8; j += 8) {
+      __m256 yv = _mm256_loadu_ps(y + j);
+      yv = _mm256_fmadd_ps(v0, _mm256_loadu_ps(a0 + j), yv);
+      yv = _mm256_fmadd_ps(v1, _mm256_loadu_ps(a1 + j), yv);
+      yv = _mm256_fmadd_ps(v2, _mm256_loadu_ps(a2 + j), yv);
+      yv = _mm256_fmadd_ps(v3, _mm256_loadu_ps(a3 + j), yv);
+      _mm256_storeu_ps(y + j, yv);
+    }
+    for (size_t j = n8; j < n; j++) {
+      y[j] += x0*a0[j] + x1*a1[j] + x2*a2[j] + x3*a3[j];
+    }
+  }
+  for (size_t i = m4; i < m; i++) {
+    const float* ai = a + i*lda;
+    const float  xi = alpha * x[i];
+    const __m256 vi = _mm256_set1_ps(xi);
+    for (size_t j = 0; j < n8; j += 8) {
+      _mm256_storeu_ps(y + j, _mm256_fmadd_ps(vi, _mm256_loadu_ps(ai + j), _mm256_loadu_ps(y + j)));
+    }
+    for (size_t j = n8; j < n; j++) {
+      y[j] += xi * ai[j];
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Rank-1 updates of a row-major A (m x n, leading dimension lda):
+//
+//   ger     : A += u * v'
+//   gerGemvT: A += u * v', then y (n) += A' * w
+//
+// gerGemvT is the learning step of a layer - update the weights, then back
+// propagate through the updated weights - in a single pass over A.  As with
+// gemv, ger and gerGemvT (below) split the kernels across the shared pool.
+template <typename K>
+void
+gerKernel(size_t m, size_t n, const K* u, const K* v, K* a, size_t lda) {
+  for (size_t i = 0; i < m; i++) {
+    K* ai = a + i*lda;
+    for (size_t j = 0; j < n; j++) {
+      ai[j] += u[i] * v[j];
+    }
+  }
+}
+
+template <typename K>
+void
+gerGemvTKernel(size_t m, size_t n, const K* u, const K* v, K* a, size_t lda, const K* w, K* y) {
+  for (size_t i = 0; i < m; i++) {
+    K* ai = a + i*lda;
+    for (size_t j = 0; j < n; j++) {
+      ai[j] += u[i] * v[j];
+      y[j]  += w[i] * ai[j];
+    }
+  }
+}
+
+#ifdef ROOK_AVX2
+inline void
+gerKernel(size_t m, size_t n, const float* u, const float* v, float* a, size_t lda) {
+  const size_t n8 = n - n%8;
+  for (size_t i = 0; i < m; i++) {
+    float*       ai = a + i*lda;
+    const __m256 ui = _mm256_set1_ps(u[i]);
+    for (size_t j = 0; j < n8; j += 8) {
+      _mm256_storeu_ps(ai + j, _mm256_fmadd_ps(ui, _mm256_loadu_ps(v + j), _mm256_loadu_ps(ai + j)));
+    }
+    for (size_t j = n8; j < n; j++) {
+      ai[j] += u[i] * v[j];
+    }
+  }
+}
+
+// Four rows at a time, as gemvT, so each load/store of y absorbs four 
+// freshly updated rows of A
+inline void
+gerGemvTKernel(size_t m, size_t n, const float* u, const float* v, float* a, size_t lda, const float* w, float* y) {
+  const size_t m4 = m - m%4;
+  const size_t n8 = n - n%8;
+  for (size_t i = 0; i < m4; i += 4) {
+    float* a0 = a + (i + 0)*lda;
+    float* a1 = a + (i + 1)*lda;
+    float* a2 = a + (i + 2)*lda;
+    float* a3 = a + (i + 3)*lda;
+    const __m256 u0 = _mm256_set1_ps(u[i + 0]), u1 = _mm256_set1_ps(u[i + 1]);
+    const __m256 u2 = _mm256_set1_ps(u[i + 2]), u3 = _mm256_set1_ps(u[i + 3]);
+    const __m256 w0 = _mm256_set1_ps(w[i + 0]), w1 = _mm256_set1_ps(w[i + 1]);
+    const __m256 w2 = _mm256_set1_ps(w[i + 2]), w3 = _mm256_set1_ps(w[i + 3]);
+    for (size_t j = 0; j < n8; j += 8) {
+      const __m256 vj = _mm256_loadu_ps(v + j);
+      const __m256 r0 = _mm256_fmadd_ps(u0, vj, _mm256_loadu_ps(a0 + j));
+      const __m256 r1 = _mm256_fmadd_ps(u1, vj, _mm256_loadu_ps(a1 + j));
+      const __m256 r2 = _mm256_fmadd_ps(u2, vj, _mm256_loadu_ps(a2 + j));
+      const __m256 r3 = _mm256_fmadd_ps(u3, vj, _mm256_loadu_ps(a3 + j));
+      _mm256_storeu_ps(a0 + j, r0);
+      _mm256_storeu_ps(a1 + j, r1);
+      _mm256_storeu_ps(a2 + j, r2);
+      _mm256_storeu_ps(a3 + j, r3);
+      __m256 yv = _mm256_loadu_ps(y + j);
+      yv = _mm256_fmadd_ps(w0, r0, yv);
+      yv = _mm256_fmadd_ps(w1, r1, yv);
+      yv = _mm256_fmadd_ps(w2, r2, yv);
+      yv = _mm256_fmadd_ps(w3, r3, yv);
+      _mm256_storeu_ps(y + j, yv);
+    }
+    for (size_t j = n8; j < n; j++) {
+      a0[j] += u[i + 0] * v[j];
+      a1[j] += u[i + 1] * v[j];
+      a2[j] += u[i + 2] * v[j];
+      a3[j] += u[i + 3] * v[j];
+      y[j]  += w[i + 0]*a0[j] + w[i + 1]*a1[j] + w[i + 2]*a2[j] + w[i + 3]*a3[j];
+    }
+  }
+  for (size_t i = m4; i < m; i++) {
+    float*       ai = a + i*lda;
+    const __m256 ui = _mm256_set1_ps(u[i]);
+    const __m256 wi = _mm256_set1_ps(w[i]);
+    for (size_t j = 0; j < n8; j += 8) {
+      const __m256 r = _mm256_fmadd_ps(ui, _mm256_loadu_ps(v + j), _mm256_loadu_ps(ai + j));
+      _mm256_storeu_ps(ai + j, r);
+      _mm256_storeu_ps(y + j, _mm256_fmadd_ps(wi, r, _mm256_loadu_ps(y + j)));
+    }
+    for (size_t j = n8; j < n; j++) {
+      ai[j] += u[i] * v[j];
+      y[j]  += w[i] * ai[j];
+    }
+  }
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Row-parallel gemv and ger, and column-parallel gemvT and gerGemvT, so that
+// no two threads ever write the same element of y or A
+template <typename K>
+void
+gemv(size_t m, size_t n, K alpha, const K* a, size_t lda, const K* x, K* y) {
+  parallelFor(m, 4, m*n, [=](size_t begin, size_t end) {
+    gemvKernel(end - begin, n, alpha, a + begin*lda, lda, x, y + begin);
+  });
+}
+
+template <typename K>
+void
+gemvT(size_t m, size_t n, K alpha, const K* a, size_t lda, const K* x, K* y) {
+  parallelFor(n, 64/sizeof(K), m*n, [=](size_t begin, size_t end) {
+    gemvTKernel(m, end - begin, alpha, a + begin, lda, x, y + begin);
+  });
+}
+
+template <typename K>
+void
+ger(size_t m, size_t n, const K* u, const K* v, K* a, size_t lda) {
+  parallelFor(m, 4, m*n, [=](size_t begin, size_t end) {
+    gerKernel(end - begin, n, u + begin, v, a + begin*lda, lda);
+  });
+}
+
+template <typename K>
+void
+gerGemvT(size_t m, size_t n, const K* u, const K* v, K* a, size_t lda, const K* w, K* y) {
+  parallelFor(n, 64/sizeof(K), m*n, [=](size_t begin, size_t end) {
+    gerGemvTKernel(m, end - begin, u, v + begin, a + begin, lda, w, y + begin);
+  });
+}
+
+//------------------------------------------------------------------------------
+// Pick an implementation from the shape of the product.  Matrix-vector
+// products go to gemv, and everything else to multiply(), whose tests fold
+// away at compile time for fixed M, L and N.
+template <size_t M, size_t L, size_t N, typename K>
+struct Multiply {
+  static void
+  apply(const K* a, const K* b, K* c) {
+    if (N == 1) {
+      gemv(M, L, (K)1, a, L, b, c);
+    } else {
+      naive<K>(M, N, L, (K)1, a, L, 1, b, N, 1, c, N, 1);
+    }
+  }
+};
+
+template <size_t M, size_t L, size_t N>
+struct Multiply<M, L, N, float> {
+  static void
+  apply(const float* a, const float* b, float* c) {
+    if (N == 1) {
+      gemv(M, L, 1.0f, a, L, b, c);
+    } else {
+      multiply(M, N, L, 1.0f, a, L, 1, b, N, 1, c, N, 1);
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace gemm
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_HOGWILDTRAINER_H
+#define INCLUDED_HOGWILDTRAINER_H
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_THREADPOOL_H
+#include "ThreadPool.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Asynchronous SGD, Hogwild style (Niu et al, 2011).  Every thread runs
+// Network::learn over its own contiguous shard of the samples, reading and
+// updating the one shared set of weights with no locks and no barriers.
+//
+// Updates race: a thread may read weights another is halfway through 
+// writing, and concurrent updates to the same weight may lose one of the
+// two increments.  Both are benign for SGD - each step only needs weights
+// that are close to current - and the network never holds more than one 
+// value per weight, so nothing can be corrupted beyond a lost update.
+template <typename Network>
+struct HogwildTrainer {
+  typedef typename Network::Input  Input;
+  typedef typename Network::Output Output;
+
+  HogwildTrainer(Network& network, size_t threads = std::thread::hardware_concurrency())
+  : network_ (network)
+  , pool_    (threads) {
+  }
+
+  // Learn samples 0 ... count - 1, where sample(i, input, target) fills in 
+  // the i'th sample.  sample is called concurrently from every thread.
+  template <typename F>
+  void learn(size_t count, F sample, float learningRate = 0.1f) {
+    const size_t threads = pool_.size();
+    pool_.parallel(threads, [&](size_t t) {
+      Input  input;
+      Output target;
+      for (size_t i = t*count/threads; i < (t + 1)*count/threads; i++) {
+        sample(i, input, target);
+        network_.learn(input, target, learningRate);
+      }
+    });
+  }
+
+  size_t threads() const {
+    return pool_.size();
+  }
+
+private:
+  Network&   network_;
+  ThreadPool pool_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,262 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_IDXDATASET_H
+#define INCLUDED_IDXDATASET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// A whole file mapped read-only.  Pages are shared with every other process
+// mapping the same file, and only read from disk when first touched.  A
+// writable mapping is private: pages are copied on first write, and the 
+// file itself is never changed.  create() makes a new file of a given size
+// and maps it shared, so writes go back to the file.
+struct MappedFile {
+  static MappedFile create(const std::string& path, size_t size) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error(path + ": cannot create");
+    }
+    if (::ftruncate(fd, size) != 0) {
+      ::close(fd);
+      throw std::runtime_error(path + ": cannot resize");
+    }
+    return MappedFile(path, fd, size);
+  }
+
+  explicit MappedFile(const std::string& path, bool writable = false)
+  : data_ (nullptr)
+  , size_ (0) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error(path + ": cannot open");
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error(path + ": cannot stat");
+    }
+
+    size_ = info.st_size;
+    if (size_ > 0) {
+      void* p = writable ? ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+                         : ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(path + ": cannot map");
+      }
+      data_ = static_cast<uint8_t*>(p);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(MappedFile&& f)
+  : data_ (f.data_)
+  , size_ (f.size_) {
+    f.data_ = nullptr;
+    f.size_ = 0;
+  }
+
+  MappedFile& operator=(MappedFile&& f) {
+    std::swap(data_, f.data_);
+    std::swap(size_, f.size_);
+    return *this;
+  }
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_) {
+      ::munmap(data_, size_);
+    }
+  }
+
+  const uint8_t* data() const { return data_; }
+  size_t         size() const { return size_; }
+
+  // Only for writable mappings
+  uint8_t*       data()       { return data_; }
+
+private:
+  MappedFile(const std::string& path, int fd, size_t size)
+  : data_ (nullptr)
+  , size_ (size) {
+    if (size_ > 0) {
+      void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(path + ": cannot map");
+      }
+      data_ = static_cast<uint8_t*>(p);
+    }
+    ::close(fd);
+  }
+
+  uint8_t* data_;
+  size_t   size_;
+};
+
+//------------------------------------------------------------------------------
+// A view of bytes owned by someone else
+struct ByteSpan {
+  ByteSpan(const uint8_t* data = nullptr, size_t size = 0)
+  : data_ (data)
+  , size_ (size) {}
+
+  const uint8_t* data()  const { return data_; }
+  size_t         size()  const { return size_; }
+  const uint8_t* begin() const { return data_; }
+  const uint8_t* end()   const { return data_ + size_; }
+
+  uint8_t operator[](size_t i) const { return data_[i]; }
+
+private:
+  const uint8_t* data_;
+  size_t         size_;
+};
+
+//------------------------------------------------------------------------------
+// One IDX file of unsigned bytes (http://yann.lecun.com/exdb/mnist/): a 
+// big-endian header - two zero bytes, the type 0x08, the number of 
+// dimensions, then each dimension as a 32-bit size - followed by the data.
+// The header is checked against the file size once, up front; items (the
+// slices along the first dimension) are then handed out in place.
+struct IdxFile {
+  explicit IdxFile(const std::string& path)
+  : file_ (path) {
+    const uint8_t* p = file_.data();
+    if (file_.size() < 4 || p[0] != 0 || p[1] != 0) {
+      throw std::runtime_error(path + ": not an IDX file");
+    }
+    if (p[2] != 0x08) {
+      throw std::runtime_error(path + ": IDX data is not unsigned bytes");
+    }
+    if (p[3] == 0) {
+      throw std::runtime_error(path + ": IDX file has no dimensions");
+    }
+
+    const size_t header = 4 + 4*p[3];
+    if (file_.size() < header) {
+      throw std::runtime_error(path + ": truncated IDX header");
+    }
+
+    size_t total = 1;
+    for (size_t d = 0; d < p[3]; d++) {
+      const uint8_t* q = p + 4 + 4*d;
+      dimensions_.push_back((uint32_t)q[0] << 24 | (uint32_t)q[1] << 16 | 
+                            (uint32_t)q[2] <<  8 | (uint32_t)q[3]);
+      if (dimensions_.back() && total > file_.size()/dimensions_.back()) {
+        throw std::runtime_error(path + ": IDX file is shorter than its header says");
+      }
+      total *= dimensions_.back();
+    }
+    if (file_.size() - header < total) {
+      throw std::runtime_error(path + ": IDX file is shorter than its header says");
+    }
+
+    data_   = p + header;
+    stride_ = dimensions_[0] ? total/dimensions_[0] : 0;
+  }
+
+  const std::vector<uint32_t>& dimensions() const { return dimensions_; }
+
+  // Number of items, and bytes in each
+  size_t count()  const { return dimensions_[0]; }
+  size_t stride() const { return stride_; }
+
+  ByteSpan operator[](size_t i) const {
+    return ByteSpan(data_ + i*stride_, stride_);
+  }
+
+  // All of the items, back to back
+  ByteSpan all() const {
+    return ByteSpan(data_, count()*stride_);
+  }
+
+private:
+  MappedFile            file_;
+  std::vector<uint32_t> dimensions_;
+  const uint8_t*        data_;
+  size_t                stride_;
+};
+
+//------------------------------------------------------------------------------
+// An IDX image file (count x rows x cols) and its label file (count), 
+// e.g. MNIST.  Images are zero-copy views into the mapped file.
+struct IdxDataset {
+  IdxDataset(const std::string& imageFile, const std::string& labelFile)
+  : images_ (imageFile)
+  , labels_ (labelFile) {
+    if (images_.dimensions().size() != 3) {
+      throw std::runtime_error(imageFile + ": expected count x rows x cols images");
+    }
+    if (labels_.dimensions().size() != 1) {
+      throw std::runtime_error(labelFile + ": expected a single dimension of labels");
+    }
+    if (images_.count() != labels_.count()) {
+      throw std::runtime_error(imageFile + ": image and label counts differ");
+    }
+  }
+
+  size_t size() const { return images_.count(); }
+  size_t rows() const { return images_.dimensions()[1]; }
+  size_t cols() const { return images_.dimensions()[2]; }
+
+  ByteSpan image(size_t i) const { return images_[i]; }
+  uint8_t  label(size_t i) const { return labels_[i][0]; }
+
+  const IdxFile& images() const { return images_; }
+  const IdxFile& labels() const { return labels_; }
+
+private:
+  IdxFile images_;
+  IdxFile labels_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
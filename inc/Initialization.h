@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_INITIALIZATION_H
+#define INCLUDED_INITIALIZATION_H
+
+#ifndef INCLUDED_RANDOM_H
+#include "Random.h"
+#endif
+
+#ifndef INCLUDED_THREADPOOL_H
+#include "ThreadPool.h"
+#endif
+
+#include <cmath>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// How to draw initial weights: N(mean, scale^2) or U(mean - scale, mean + scale),
+// with the usual schemes for picking the scale from a layer's fan-in and 
+// fan-out:
+//   Xavier (Glorot)  variance 2/(in + out), for sigmoid and tanh layers
+//   He               variance 2/in, for rectifiers
+//
+// Unless given one, a fill takes its seed from nextSeed() (see Random.h).
+struct Initialization {
+  enum Distribution { Normal, Uniform };
+
+  Distribution distribution;
+  float        mean;
+  float        scale;
+
+  static Initialization normal(float mean, float deviation) { 
+    return Initialization{Normal, mean, deviation}; 
+  }
+
+  static Initialization uniform(float low, float high) { 
+    return Initialization{Uniform, 0.5f*(low + high), 0.5f*(high - low)}; 
+  }
+
+  static Initialization xavier(size_t in, size_t out)        { return normal(0.0f, std::sqrt(2.0f/(in + out))); }
+  static Initialization xavierUniform(size_t in, size_t out) { return symmetric(std::sqrt(6.0f/(in + out))); }
+  static Initialization he(size_t in)                        { return normal(0.0f, std::sqrt(2.0f/in)); }
+  static Initialization heUniform(size_t in)                 { return symmetric(std::sqrt(6.0f/in)); }
+
+  // Fill out[0] ... out[n - 1].  The values are drawn a block at a time, 
+  // each block from its own stream of seed, so big matrices fill in 
+  // parallel and the result depends only on the seed - not on the number
+  // of threads, or which thread drew which block.
+  void fill(float* out, size_t n, uint64_t seed = nextSeed()) const {
+    const size_t blocks = (n + Block - 1)/Block;
+    parallelFor(blocks, 1, n*16, [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; b++) {
+        CounterRandom random(seed, b);
+        float*       block = out + b*Block;
+        const size_t size  = std::min(size_t(Block), n - b*Block);
+        if (distribution == Normal) {
+          random.normal(block, size, mean, scale);
+        } else {
+          random.uniform(block, size);
+          for (size_t i = 0; i < size; i++) {
+            block[i] = mean + scale*(2.0f*block[i] - 1.0f);
+          }
+        }
+      }
+    });
+  }
+
+private:
+  static const size_t Block = 4096;
+
+  static Initialization symmetric(float limit) {
+    return Initialization{Uniform, 0.0f, limit};
+  }
+};
+
+//------------------------------------------------------------------------------
+// One normal number at a time, from a stream of one's own - refilled a 
+// couple of vectors at a time.  A copy is a fresh stream with the next 
+// seed, so copies never repeat each other's numbers.
+struct NormalStream {
+  NormalStream(float mean, float deviation, uint64_t seed = nextSeed())
+  : random_    (seed)
+  , mean_      (mean)
+  , deviation_ (deviation)
+  , next_      (Size)
+  , buffer_    () {}
+
+  NormalStream(const NormalStream& other)
+  : NormalStream(other.mean_, other.deviation_) {}
+
+  NormalStream(NormalStream&&)            = default;
+  NormalStream& operator=(NormalStream&&) = default;
+
+  NormalStream& operator=(const NormalStream& other) {
+    return *this = NormalStream(other.mean_, other.deviation_);
+  }
+
+  float operator()() {
+    if (next_ == Size) {
+      random_.normal(buffer_, Size, mean_, deviation_);
+      next_ = 0;
+    }
+    return buffer_[next_++];
+  }
+
+private:
+  static const size_t Size = 2*math::Native::width;
+
+  CounterRandom random_;
+  float         mean_;
+  float         deviation_;
+  size_t        next_;
+  float         buffer_[Size];
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
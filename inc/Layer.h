@@ -31,12 +31,24 @@
 #include "Matrix.h"
 #endif
 
+#ifndef INCLUDED_VECTORMATH_H
+#include "VectorMath.h"
+#endif
+
+#include <cmath>
+
 //------------------------------------------------------------------------------
 
 namespace rook { 
 
 //------------------------------------------------------------------------------
 // Activations
+//
+// Besides the scalar activation/derivative, each activation has vectorized
+// kernels over n contiguous values (see VectorMath.h):
+//   activate(z, y, n)  y[i] = activation(z[i])
+//   derive(y, d, n)    d[i] = derivative(y[i])
+// z and y (or y and d) may alias.
 struct Sigmoid  {
   static float activation(float z) {
     return 1.0f/(1.0f + expf(-z));
@@ -45,6 +57,31 @@ struct Sigmoid  {
   static float derivative(float y) {
     return y*(1.0f - y);
   }
+
+  template <typename Precision>
+  struct Forward {
+    template <typename V>
+    static typename V::F apply(typename V::F z) {
+      const typename V::F one = V::set(1.0f);
+      return V::div(one, V::add(one, math::exp<V>(V::sub(V::set(0.0f), z), Precision())));
+    }
+  };
+
+  struct Backward {
+    template <typename V>
+    static typename V::F apply(typename V::F y) {
+      return V::mul(y, V::sub(V::set(1.0f), y));
+    }
+  };
+
+  template <typename Precision = math::DefaultPrecision>
+  static void activate(const float* z, float* y, size_t n) {
+    math::map<Forward<Precision>>(z, y, n);
+  }
+
+  static void derive(const float* y, float* d, size_t n) {
+    math::map<Backward>(y, d, n);
+  }
 };
 
 struct Linear  {
@@ -52,18 +89,58 @@ struct Linear  {
     return z;
   }
 
-  static float derivative(float y) {
+  static float derivative(float /*y*/) {
     return 1.0f;
   }
+
+  template <typename Precision = math::DefaultPrecision>
+  static void activate(const float* z, float* y, size_t n) {
+    std::copy(z, z + n, y);
+  }
+
+  static void derive(const float* /*y*/, float* d, size_t n) {
+    std::fill(d, d + n, 1.0f);
+  }
 };
 
+// Note the scalar versions used to call abs(), which truncates to int
 struct Sinc  {
   static float activation(float z) {
-    return abs(z)<1.0e-10f ? 1.0f : sin(z)/z;
+    return std::fabs(z)<1.0e-10f ? 1.0f : std::sin(z)/z;
   }
 
   static float derivative(float y) {
-    return abs(y)<1.0e-10f ? 0.0f : (cos(y)/y) - (sin(y)/(y*y));
+    return std::fabs(y)<1.0e-10f ? 0.0f : (std::cos(y)/y) - (std::sin(y)/(y*y));
+  }
+
+  struct Forward {
+    template <typename V>
+    static typename V::F apply(typename V::F z) {
+      typename V::F s, c;
+      math::sincos<V>(z, s, c);
+      const typename V::F tiny = V::less(math::abs<V>(z), V::set(1.0e-10f));
+      return V::select(tiny, V::set(1.0f), V::div(s, z));
+    }
+  };
+
+  struct Backward {
+    template <typename V>
+    static typename V::F apply(typename V::F y) {
+      typename V::F s, c;
+      math::sincos<V>(y, s, c);
+      const typename V::F tiny = V::less(math::abs<V>(y), V::set(1.0e-10f));
+      const typename V::F d    = V::div(V::sub(c, V::div(s, y)), y);
+      return V::select(tiny, V::set(0.0f), d);
+    }
+  };
+
+  template <typename Precision = math::DefaultPrecision>
+  static void activate(const float* z, float* y, size_t n) {
+    math::map<Forward>(z, y, n);
+  }
+
+  static void derive(const float* y, float* d, size_t n) {
+    math::map<Backward>(y, d, n);
   }
 };
 
@@ -75,6 +152,29 @@ struct Hinge  {
   static float derivative(float y) {
     return y > 0.0f ? 1.0f : 0.0f;
   }
+
+  struct Forward {
+    template <typename V>
+    static typename V::F apply(typename V::F z) {
+      return V::max(z, V::set(0.0f));
+    }
+  };
+
+  struct Backward {
+    template <typename V>
+    static typename V::F apply(typename V::F y) {
+      return V::andf(V::greater(y, V::set(0.0f)), V::set(1.0f));
+    }
+  };
+
+  template <typename Precision = math::DefaultPrecision>
+  static void activate(const float* z, float* y, size_t n) {
+    math::map<Forward>(z, y, n);
+  }
+
+  static void derive(const float* y, float* d, size_t n) {
+    math::map<Backward>(y, d, n);
+  }
 };
 
 struct Softmax {
@@ -113,11 +213,40 @@ struct Layer {
   typedef    Matrix<Y, X, float> WeightMatrix;
   typedef ColVector<   Y, float> Bias;
 
+  // Mini-batches are column-blocked: each of the B columns is one sample
+  template <size_t B> using InputBatch  = Matrix<X, B, float>;
+  template <size_t B> using OutputBatch = Matrix<Y, B, float>;
+
+  // An accumulated gradient of the loss, for training schemes that 
+  // separate computing an update from applying it
+  struct Gradient {
+    WeightMatrix weights;
+    Bias         bias;
+
+    Gradient& operator+=(const Gradient& other) {
+      weights += other.weights;
+      bias    += other.bias;
+      return *this;
+    }
+
+    void clear() {
+      weights.raw().fill(0.0f);
+      bias.raw().fill(0.0f);
+    }
+  };
+
   Layer() 
-  : weightMatrix_ (WeightMatrix(normal(initialMean, initialDeviation)))
-  , bias_         (        Bias(normal(initialMean, initialDeviation)))
+  : Layer(Initialization::normal(initialMean, initialDeviation))
   {}
 
+  // Draw the weights (and bias) according to a scheme - e.g.
+  // Initialization::xavier(X, Y).  Big weight matrices fill in parallel.
+  explicit Layer(const Initialization& weights, 
+                 const Initialization& bias = Initialization::normal(initialMean, initialDeviation)) {
+    weights.fill(weightMatrix_.raw().data(), X*Y);
+    bias.fill(bias_.raw().data(), Y);
+  }
+
   // Set the weights explicitly
   Layer(const WeightMatrix& weightMatrix, const Bias& bias)
   : weightMatrix_ (weightMatrix) 
@@ -125,89 +254,193 @@ struct Layer {
 
   // Set the weights explicitly
   Layer(const WeightMatrix& weightMatrix)
-  : weightMatrix_ (weightMatrix) 
-  , bias_         (Bias(normal(initialMean, initialDeviation)))
-  {}
+  : weightMatrix_ (weightMatrix) {
+    Initialization::normal(initialMean, initialDeviation).fill(bias_.raw().data(), Y);
+  }
 
   // For inference, we take an input vector and 
   // calculate an output vector according to
   // our activation function 
   Output
   infer(Input const& input) const {
-    // These temps should be optimized out
-    //const auto biased = aug(input, 1.0f); 
-    const auto sum    = (weightMatrix_ * input) + bias_;
-
-    // Apply our activation function to each
-    // output
-    return sum.apply([&](float z) -> float {
-      return Activation::activation(z); 
-    });
+    // The bias is added as the product is stored, then 
+    // the activation runs vectorized over the whole output
+    Output output = gemv(weightMatrix_, input) + bias_;
+    Activation::activate(output.raw().data(), output.raw().data(), Y);
+    return output;
   }
 
   std::tuple<Input, Output>
   learn(Input  const& x, Output const& y, Output const& t, float learningRate = 0.1f) {
-    // For each output 
-    const auto dError = Loss::derivative(y, t);
-    for (auto i = 0; i < Y; i++) {
-      // Look at each input from the previous layer
-      for (auto j = 0; j < X; j++) {
-        // Calculate the partial deriviate of the error with
-        // respect to the weight
-        auto dWeight = dError.at(i) * Activation::derivative(y.at(i)) * x.at(j);
-
-        // Adjust our weights according to this error
-        // derivative and the learning rate
-        weightMatrix_.at(i,j) += dWeight * learningRate;
+    const Output dError = Loss::derivative(y, t);
+    return std::make_tuple(update(x, y, dError, learningRate), Loss::error(y, t));
+  }
+
+  // Batched inference - one GEMM for the whole batch, then the bias
+  // and a vectorized activation over the result
+  template <size_t B>
+  OutputBatch<B>
+  inferBatch(InputBatch<B> const& input) const {
+    OutputBatch<B> result = weightMatrix_ * input;
+    float* row = result.raw().data();
+    for (size_t i = 0; i < Y; i++, row += B) {
+      const float bias = bias_.at(i);
+      for (size_t b = 0; b < B; b++) {
+        row[b] += bias;
       }
+    }
+    Activation::activate(result.raw().data(), result.raw().data(), Y*B);
+    return result;
+  }
+
+  // Batched learning.  The gradient is averaged over the B samples and
+  // applied as a single update, so a batch of one is identical to learn().
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  learnBatch(InputBatch<B>  const& x, 
+             OutputBatch<B> const& y, 
+             OutputBatch<B> const& t, 
+             float                 learningRate = 0.1f) {
+    const OutputBatch<B> dError = Loss::derivative(y, t);
+    return std::make_tuple(updateBatch(x, y, dError, learningRate), Loss::error(y, t));
+  }
 
-      // Don't forget about the bias
-      auto dBias = dError.at(i) * Activation::derivative(y.at(i));
-      bias_.at(i) += dBias * learningRate;
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  correctBatch(InputBatch<B>  const& input, 
+               OutputBatch<B> const& output, 
+               OutputBatch<B> const& error, 
+               float                 learningRate = 0.1f) {
+    const OutputBatch<B> target = output + error;
+    const OutputBatch<B> dError = Loss::derivative(output, target);
+    return std::make_tuple(updateBatch(input, output, dError, learningRate), Loss::error(output, target));
+  }
+
+  // Accumulate the gradient for a batch into gradient, leaving the weights
+  // alone, and back propagate the error through the current weights
+  template <size_t B>
+  std::tuple<InputBatch<B>, OutputBatch<B>>
+  gradientBatch(InputBatch<B>  const& x, 
+                OutputBatch<B> const& y, 
+                OutputBatch<B> const& t, 
+                Gradient&             gradient) const {
+    const OutputBatch<B> dError = Loss::derivative(y, t);
+
+    OutputBatch<B> delta;
+    Activation::derive(y.raw().data(), delta.raw().data(), Y*B);
+    for (size_t i = 0; i < Y; i++) {
+      float dBias = 0.0f;
+      for (size_t b = 0; b < B; b++) {
+        delta.at(i, b) *= dError.at(i, b);
+        dBias += delta.at(i, b);
+      }
+      gradient.bias.at(i) += dBias;
     }
 
-    // Back propagate the error
-    return std::make_tuple(weightMatrix_.transpose() * dError, Loss::error(y, t));
+    gemm::multiply(Y, X, B, 1.0f,
+                   delta.raw().data(),            B, 1,
+                   x.raw().data(),                1, B,
+                   gradient.weights.raw().data(), X, 1);
+
+    InputBatch<B> result;
+    gemm::multiply(X, B, Y, 1.0f,
+                   weightMatrix_.raw().data(), 1, X,
+                   dError.raw().data(),        B, 1,
+                   result.raw().data(),        B, 1);
+    return std::make_tuple(result, Loss::error(y, t));
+  }
+
+  // Step along an accumulated gradient
+  void
+  apply(Gradient const& gradient, float rate) {
+    weightMatrix_ += gradient.weights.apply(pure([=](float g) { return g * rate; }));
+    bias_         += gradient.bias.apply(pure([=](float g) { return g * rate; }));
   }
 
   WeightMatrix& getWeightMatrix() {
     return weightMatrix_;
   }
 
+  const WeightMatrix& getWeightMatrix() const {
+    return weightMatrix_;
+  }
+
   Bias& getBias() {
     return bias_;
   }
 
+  const Bias& getBias() const {
+    return bias_;
+  }
+
   std::tuple<Input, Output>
   correct(Input  const& input, 
           Output const& output, 
           Output const& error, 
           float         learningRate = 0.1f) {
-    // For each output 
-    const auto target = output + error;
-    const auto dError = Loss::derivative(output, target);
-    for (auto i = 0; i < Y; i++) {
-      // Look at each input from the previous layer
-      for (auto j = 0; j < X; j++) {
-        // Calculate the partial deriviate of the error with
-        // respect to the weight
-        auto dWeight = dError.at(i) * Activation::derivative(output.at(i)) * input.at(j);
-
-        // Adjust our weights according to this error
-        // derivative and the learning rate
-        weightMatrix_.at(i,j) += dWeight * learningRate;
-      }
+    const Output target = output + error;
+    const Output dError = Loss::derivative(output, target);
+    return std::make_tuple(update(input, output, dError, learningRate), Loss::error(output, target));
+  }
 
-      // Don't forget about the bias
-      auto dBias = dError.at(i) * Activation::derivative(output.at(i));
-      bias_.at(i) += dBias * learningRate;
+private:
+  // Apply one update for a single sample and back propagate its error.
+  // The slope of the activation is taken once per output, and the weight
+  // update W += lr * delta * x' and W' * dError share one pass over W.
+  Input
+  update(Input  const& x, 
+         Output const& y, 
+         Output const& dError, 
+         float         learningRate) {
+    Output delta;
+    Activation::derive(y.raw().data(), delta.raw().data(), Y);
+    delta = (delta % dError).apply(pure([=](float d) { return d * learningRate; }));
+    bias_ += delta;
+
+    Input result;
+    gemm::gerGemvT(Y, X, delta.raw().data(), x.raw().data(), 
+                   weightMatrix_.raw().data(), X, 
+                   dError.raw().data(), result.raw().data());
+    return result;
+  }
+
+  // Apply one averaged update for a batch and back propagate its error
+  template <size_t B>
+  InputBatch<B>
+  updateBatch(InputBatch<B>  const& x, 
+              OutputBatch<B> const& y, 
+              OutputBatch<B> const& dError, 
+              float                 learningRate) {
+    const float rate = learningRate/B;
+
+    // Scale each error by the slope of the activation, and take the
+    // bias update while we're at it
+    OutputBatch<B> delta;
+    Activation::derive(y.raw().data(), delta.raw().data(), Y*B);
+    for (size_t i = 0; i < Y; i++) {
+      float dBias = 0.0f;
+      for (size_t b = 0; b < B; b++) {
+        delta.at(i, b) *= dError.at(i, b);
+        dBias += delta.at(i, b);
+      }
+      bias_.at(i) += dBias * rate;
     }
 
-    // Back propagate the error
-    return std::make_tuple(weightMatrix_.transpose() * dError, Loss::error(output, target));
+    // W += rate * delta * x' as a single GEMM (x' is just a stride swap)
+    gemm::multiply(Y, X, B, rate,
+                   delta.raw().data(),        B, 1,
+                   x.raw().data(),            1, B,
+                   weightMatrix_.raw().data(), X, 1);
+
+    // Back propagate the error: W' * dError
+    InputBatch<B> result;
+    gemm::multiply(X, B, Y, 1.0f,
+                   weightMatrix_.raw().data(), 1, X,
+                   dError.raw().data(),        B, 1,
+                   result.raw().data(),        B, 1);
+    return result;
   }
 
-private:
   WeightMatrix  weightMatrix_;
   Bias          bias_;
 };
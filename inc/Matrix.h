@@ -32,20 +32,149 @@
 #include <iomanip>
 #include <cstdint>
 #include <array>
+#include <algorithm>
 #include <functional>
+#include <type_traits>
+
+#ifndef INCLUDED_MEMORY_H
+#include "Memory.h"
+#endif
+
+#ifndef INCLUDED_EXPRESSION_H
+#include "Expression.h"
+#endif
+
+#ifndef INCLUDED_INITIALIZATION_H
+#include "Initialization.h"
+#endif
 
 //------------------------------------------------------------------------------
 
 namespace rook { 
 
+//------------------------------------------------------------------------------
+// Storage policies.  Inline keeps the elements inside the Matrix itself, 
+// which is best for small vectors.  Heap keeps them in a cache-line aligned
+// heap block, so big matrices stay off the stack, move in constant time and
+// can be read with aligned SIMD loads.  By default anything over 16KB goes 
+// on the heap.
+//
+// Either can borrow() elements from someone else - e.g. a mapped checkpoint
+// (see Checkpoint.h).  Heap storage uses them in place, and they must stay
+// put for as long as the storage does; Inline storage just copies them.
+struct Inline {};
+struct Heap   {};
+
+template <size_t Bytes>
+struct DefaultStorage {
+  typedef typename std::conditional<(Bytes > 16384), Heap, Inline>::type type;
+};
+
+template <typename K, size_t Size, typename S>
+struct Storage;
+
+template <typename K, size_t Size>
+struct Storage<K, Size, Inline> {
+  typedef std::array<K, Size> Array;
+
+  Storage() : array_() {}
+
+  void borrow(K* data) {
+    std::copy(data, data + Size, array_.begin());
+  }
+
+  Array&       array()       { return array_; }
+  const Array& array() const { return array_; }
+
+private:
+  Array array_;
+};
+
+// A moved-from Heap matrix may only be assigned to or destroyed
+template <typename K, size_t Size>
+struct Storage<K, Size, Heap> {
+  typedef std::array<K, Size> Array;
+
+  Storage() 
+  : pArray_(new (alignedAlloc(sizeof(Array))) Array())
+  , owned_(true) {}
+
+  Storage(const Storage& s) 
+  : pArray_(new (alignedAlloc(sizeof(Array))) Array(*s.pArray_))
+  , owned_(true) {}
+
+  Storage(Storage&& s) 
+  : pArray_(s.pArray_)
+  , owned_(s.owned_) { 
+    s.pArray_ = 0; 
+    s.owned_  = true;
+  }
+
+  Storage& operator=(const Storage& s) {
+    if (!pArray_) {
+      pArray_ = new (alignedAlloc(sizeof(Array))) Array();
+      owned_  = true;
+    }
+    *pArray_ = *s.pArray_;
+    return *this;
+  }
+
+  Storage& operator=(Storage&& s) {
+    std::swap(pArray_, s.pArray_);
+    std::swap(owned_,  s.owned_);
+    return *this;
+  }
+
+  ~Storage() {
+    if (owned_) alignedFree(pArray_);
+  }
+
+  void borrow(K* data) {
+    if (owned_) alignedFree(pArray_);
+    pArray_ = reinterpret_cast<Array*>(data);
+    owned_  = false;
+  }
+
+  Array&       array()       { return *pArray_; }
+  const Array& array() const { return *pArray_; }
+
+private:
+  Array* pArray_;
+  bool   owned_;
+};
+
+//------------------------------------------------------------------------------
+// Can an F be called with Args?  Used to tell generators that take (i, j)
+// from those that take (i)
+template <typename F, typename...Args>
+struct IsCallable {
+  template <typename G>
+  static auto test(int) -> decltype(std::declval<G&>()(std::declval<Args>()...), std::true_type());
+  template <typename G>
+  static std::false_type test(...);
+
+  typedef decltype(test<F>(0)) type;
+  static const bool value = type::value;
+};
+
+template <typename F>
+struct IsGenerator {
+  static const bool value = !IsExpression<F>::value && 
+                            (IsCallable<F, size_t, size_t>::value || 
+                             IsCallable<F, size_t>::value);
+};
+
 //------------------------------------------------------------------------------
 
 // An MxN matrix (M rows, N columns) over a 
-// field K (defaults to float)
-template <size_t M, size_t N, typename K = float>
-struct Matrix {
+// field K (defaults to float), stored according
+// to the policy S (see above)
+template <size_t M, size_t N, typename K = float, 
+          typename S = typename DefaultStorage<M*N*sizeof(K)>::type>
+struct Matrix : Expression<Matrix<M, N, K, S>> {
   // Static definitions
   typedef K Field;
+  typedef S StoragePolicy;
   static const size_t rows = M;
   static const size_t cols = N;
 
@@ -54,13 +183,19 @@ struct Matrix {
 
   // Constructors
   Matrix(const std::array<K, M*N>& m); 
+  template <typename F, typename = typename std::enable_if<IsGenerator<F>::value>::type>
+  Matrix(F                                 func) { generate(func); } 
   Matrix(std::function<K (size_t, size_t)> func) { generate(func); } 
   Matrix(std::function<K (size_t)>         func) { generate(func); } 
   Matrix(); 
+
+  // Evaluate an element-wise expression (see Expression.h) in one pass
+  template <typename E> Matrix(Expression<E> const& e) { *this = e; }
+  template <typename E> Matrix& operator=(Expression<E> const& e);
   
   // Arithmetic
-  Matrix operator+=(Matrix const& a);
-  Matrix operator-=(Matrix const& a);
+  template <typename E> Matrix& operator+=(Expression<E> const& e);
+  template <typename E> Matrix& operator-=(Expression<E> const& e);
 
   // Indexing
   K  at(size_t i, size_t j) const;
@@ -68,6 +203,10 @@ struct Matrix {
   K  at(size_t i) const;
   K& at(size_t i);
 
+  // Row-major linear indexing over all M*N elements
+  K  operator[](size_t i) const { return raw()[i]; }
+  K& operator[](size_t i)       { return raw()[i]; }
+
   Col&  col(size_t i);
   Row&  row(size_t i);
 
@@ -80,24 +219,47 @@ struct Matrix {
 
   Matrix<N, M, K> transpose() const;
 
+  // Element-wise operations take any callable - func(i, j) or func(i) for
+  // generators - so lambdas and functors are inlined into the loop.  The 
+  // std::function overloads are kept for compatibility.
+  template <typename F> 
+  void             generate(F func);
   void             generate(std::function<K (size_t, size_t)> func);
   void             generate(std::function<K (size_t)>         func);
 
-  Matrix<M, N, K>  apply   (std::function<K (K)> func)              const;
+  // Lazy (see Expression.h)
+  using Expression<Matrix>::apply;
+  Matrix           apply   (std::function<K (K)> func)              const &;
+
+  template <typename F> 
+  Matrix           each    (F func)                                 const;
+  Matrix           each    (std::function<K (size_t, size_t)> func) const;
+  Matrix           each    (std::function<K (size_t)> func)         const;
 
-  Matrix<M, N, K>  each    (std::function<K (size_t, size_t)> func) const;
-  Matrix<M, N, K>  each    (std::function<K (size_t)> func)         const;
+  template <typename F> 
+  Matrix           eachRow (F func)                                          const;
+  Matrix           eachRow (std::function<void (size_t, const Row&)> func)   const;
+  template <typename F> 
+  Matrix           eachCol (F func)                                          const;
+  Matrix           eachCol (std::function<void (size_t, const Col&)> func)   const;
 
-  Matrix<M, N, K>  eachRow (std::function<void (size_t, const Row&)> func)   const;
-  Matrix<M, N, K>  eachCol (std::function<void (size_t, const Col&)> func)   const;
+  // Use the M*N elements at data from now on (see Storage, above)
+  void borrow(K* data) { storage_.borrow(data); }
 
-  std::array<K, M*N>&       raw()       { return weightMatrix_; }
-  const std::array<K, M*N>& raw() const { return weightMatrix_; }
+  std::array<K, M*N>&       raw()       { return storage_.array(); }
+  const std::array<K, M*N>& raw() const { return storage_.array(); }
 
 private:
-  std::array<K, M*N> weightMatrix_;
+  template <typename F> void fill(F& func, std::true_type);
+  template <typename F> void fill(F& func, std::false_type);
+
+  Storage<K, M*N, S> storage_;
 };
 
+// Matrices are the leaves of expression trees
+template <size_t M, size_t N, typename K, typename S>
+struct IsLeaf<Matrix<M, N, K, S>> : std::true_type {};
+
 // A column vector of size N has N rows and 
 // a single column
 template <size_t N, typename K = float>
@@ -120,12 +282,14 @@ K zero(size_t i) {
   return (K)0.0f;
 }
 
-std::function<float (size_t, size_t)> normal(float mean, float stddev) {
-  static std::random_device rd;
-  static std::mt19937       gen(rd());
-  static std::normal_distribution<> normal(mean, stddev);
-  return [&](size_t i, size_t j) -> float {
-    return normal(gen); 
+// Each generator draws from a stream of its own (see Initialization.h), so
+// generators may be used from any thread, and seeded runs are repeatable.
+// Copies of a generator draw from fresh streams, so two matrices made from
+// copies of one normal() still get different values.
+inline std::function<float (size_t, size_t)> normal(float mean, float stddev) {
+  NormalStream stream(mean, stddev);
+  return [stream](size_t, size_t) mutable -> float {
+    return stream(); 
   };
 }
 
@@ -29,95 +29,121 @@
 
 #include <cmath>
 
+#ifndef INCLUDED_GEMM_H
+#include "Gemm.h"
+#endif
+
 //------------------------------------------------------------------------------
 
 namespace rook {
 
 //------------------------------------------------------------------------------
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K>::Matrix(const std::array<K, M*N>& m) 
-: weightMatrix_(m) { 
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S>::Matrix(const std::array<K, M*N>& m) { 
+  raw() = m;
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K>::Matrix() 
-: weightMatrix_({0}) { 
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S>::Matrix() { 
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::operator+=(Matrix const& a) {
-  for (int i = 0; i < M; i++) {
-    for (int j = 0; j < N; j++) {
-      at(i, j) += a.at(i, j);    
+template <size_t M, size_t N, typename K, typename S>
+template <typename E>
+Matrix<M, N, K, S>& 
+Matrix<M, N, K, S>::operator=(Expression<E> const& e) {
+  static_assert(E::rows == M && E::cols == N, "expression has the wrong shape");
+  const E& expr = e.derived();
+  K*       data = raw().data();
+  parallelFor(M*N, 64/sizeof(K), IsConcurrent<E>::value ? M*N : 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      data[i] = expr[i];
     }
-  }
+  });
   return *this;
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::operator-=(Matrix const& a) {
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < M; j++) {
-      at(i, j) -= a.at(i, j);    
+template <size_t M, size_t N, typename K, typename S>
+template <typename E>
+Matrix<M, N, K, S>& 
+Matrix<M, N, K, S>::operator+=(Expression<E> const& e) {
+  static_assert(E::rows == M && E::cols == N, "expression has the wrong shape");
+  const E& expr = e.derived();
+  K*       data = raw().data();
+  parallelFor(M*N, 64/sizeof(K), IsConcurrent<E>::value ? M*N : 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      data[i] += expr[i];
     }
-  }
+  });
+  return *this;
+}
+
+template <size_t M, size_t N, typename K, typename S>
+template <typename E>
+Matrix<M, N, K, S>& 
+Matrix<M, N, K, S>::operator-=(Expression<E> const& e) {
+  static_assert(E::rows == M && E::cols == N, "expression has the wrong shape");
+  const E& expr = e.derived();
+  K*       data = raw().data();
+  parallelFor(M*N, 64/sizeof(K), IsConcurrent<E>::value ? M*N : 0, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      data[i] -= expr[i];
+    }
+  });
   return *this;
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 K 
-Matrix<M, N, K>::at(size_t i, size_t j) const {
-  return weightMatrix_[(N*i) + j];
+Matrix<M, N, K, S>::at(size_t i, size_t j) const {
+  return raw()[(N*i) + j];
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 K& 
-Matrix<M, N, K>::at(size_t i, size_t j) {
-  return weightMatrix_[(N*i) + j];
+Matrix<M, N, K, S>::at(size_t i, size_t j) {
+  return raw()[(N*i) + j];
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 K 
-Matrix<M, N, K>::at(size_t i) const {
+Matrix<M, N, K, S>::at(size_t i) const {
   return M == 1?
     at(0, i):
     at(i, 0); 
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 K&  
-Matrix<M, N, K>::at(size_t i) {
+Matrix<M, N, K, S>::at(size_t i) {
   return M == 1?
     at(0, i):
     at(i, 0); 
 }
 
-template <size_t M, size_t N, typename K>
-typename Matrix<M, N, K>::Col
-Matrix<M, N, K>::col(size_t j) const {
-  Matrix<M, N, K>::Col result;
+template <size_t M, size_t N, typename K, typename S>
+typename Matrix<M, N, K, S>::Col
+Matrix<M, N, K, S>::col(size_t j) const {
+  Matrix<M, N, K, S>::Col result;
   for (int i = 0; i < M; i++) {
     result.at(i) = at(i, j); 
   }
   return result;
 }
 
-template <size_t M, size_t N, typename K>
-typename Matrix<M, N, K>::Row
-Matrix<M, N, K>::row(size_t i) const {
-  Matrix<M, N, K>::Row result;
+template <size_t M, size_t N, typename K, typename S>
+typename Matrix<M, N, K, S>::Row
+Matrix<M, N, K, S>::row(size_t i) const {
+  Matrix<M, N, K, S>::Row result;
   for (int j = 0; j < N; j++) {
     result.at(j) = at(i, j); 
   }
   return result;
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 void 
-Matrix<M, N, K>::print(const std::string& name) const {
+Matrix<M, N, K, S>::print(const std::string& name) const {
   std::cout << name << std::endl;
   for (size_t i = 0; i < M; i++) {
     std::cout << "| ";
@@ -129,9 +155,9 @@ Matrix<M, N, K>::print(const std::string& name) const {
   std::cout << std::endl;
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
 Matrix<N, M, K>
-Matrix<M, N, K>::transpose() const {
+Matrix<M, N, K, S>::transpose() const {
   Matrix<N, M, K> result;
   for (size_t i = 0; i < N; i++) {
     for (size_t j = 0; j < M; j++) {
@@ -143,9 +169,17 @@ Matrix<M, N, K>::transpose() const {
 
 //------------------------------------------------------------------------------
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
+void
+Matrix<M, N, K, S>::generate(F func) {
+  fill(func, typename IsCallable<F, size_t, size_t>::type());
+}
+
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
 void
-Matrix<M, N, K>::generate(std::function<K (size_t, size_t)> func) {
+Matrix<M, N, K, S>::fill(F& func, std::true_type) {
   for (size_t i = 0; i < M; i++) {
     for (size_t j = 0; j < N; j++) {
       at(i, j) = func(i, j);  
@@ -153,115 +187,121 @@ Matrix<M, N, K>::generate(std::function<K (size_t, size_t)> func) {
   }
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
 void
-Matrix<M, N, K>::generate(std::function<K (size_t)> func) {
+Matrix<M, N, K, S>::fill(F& func, std::false_type) {
   for (size_t i = 0; i < std::max(M, N); i++) {
     at(i) = func(i);  
   }
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::apply(std::function<K (K)> func) const {
-  Matrix<M, N, K> result;
-  for (size_t i = 0; i < M; i++) {
-    for (size_t j = 0; j < N; j++) {
-      result.at(i, j) = func(at(i, j));  
-    } 
-  }
-  return result;
+template <size_t M, size_t N, typename K, typename S>
+void
+Matrix<M, N, K, S>::generate(std::function<K (size_t, size_t)> func) {
+  fill(func, std::true_type());
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::each(std::function<K (size_t, size_t)> func) const {
-  Matrix<M, N, K> result;
-  for (size_t i = 0; i < M; i++) {
-    for (size_t j = 0; j < N; j++) {
-      result.at(i, j) = func(i, j);  
-    } 
-  }
-  return result;
+template <size_t M, size_t N, typename K, typename S>
+void
+Matrix<M, N, K, S>::generate(std::function<K (size_t)> func) {
+  fill(func, std::false_type());
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::each(std::function<K (size_t)> func) const {
-  Matrix<M, N, K> result;
-  for (size_t i = 0; i < std::max(M,N); i++) {
-    result.at(i) = func(i);  
-  }
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::apply(std::function<K (K)> func) const & {
+  return Expression<Matrix>::apply(func);
+}
+
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::each(F func) const {
+  Matrix result;
+  result.generate(func);
   return result;
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::eachRow(std::function<void (size_t, const Matrix<M, N, K>::Row&)> func) const {
-  Matrix<M, N, K> result;
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::each(std::function<K (size_t, size_t)> func) const {
+  return each<std::function<K (size_t, size_t)>>(func);
+}
+
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::each(std::function<K (size_t)> func) const {
+  return each<std::function<K (size_t)>>(func);
+}
+
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::eachRow(F func) const {
+  Matrix result;
   for (size_t i = 0; i < M; i++) {
     func(i, row(i));  
   }
   return result;
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-Matrix<M, N, K>::eachCol(std::function<void (size_t, const Matrix<M, N, K>::Col&)> func) const {
-  Matrix<M, N, K> result;
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::eachRow(std::function<void (size_t, const Row&)> func) const {
+  return eachRow<std::function<void (size_t, const Row&)>>(func);
+}
+
+template <size_t M, size_t N, typename K, typename S>
+template <typename F>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::eachCol(F func) const {
+  Matrix result;
   for (size_t i = 0; i < N; i++) {
     func(i, col(i));  
   }
   return result;
 }
 
-//------------------------------------------------------------------------------
-
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-operator+(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
-  a += b;
-  return a;  
+template <size_t M, size_t N, typename K, typename S>
+Matrix<M, N, K, S> 
+Matrix<M, N, K, S>::eachCol(std::function<void (size_t, const Col&)> func) const {
+  return eachCol<std::function<void (size_t, const Col&)>>(func);
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-operator-(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
-  a -= b;
-  return a;  
-}
+//------------------------------------------------------------------------------
 
-//TODO VECTORIZE
-template <size_t L, size_t M, size_t N, typename K>
+// Blocked GEMM for large products, simple loops for small ones
+// (see Gemm.h)
+template <size_t L, size_t M, size_t N, typename K, typename SA, typename SB>
 Matrix<M, N, K> 
-operator*(Matrix<M, L, K> const& a, Matrix<L, N, K> const& b) {
+operator*(Matrix<M, L, K, SA> const& a, Matrix<L, N, K, SB> const& b) {
   Matrix<M, N, K> result;
-  for (size_t i = 0; i < M; i++) {
-    for (size_t j = 0; j < N; j++) {
-      for (size_t k = 0; k < L; k++) {
-        result.at(i, j) += a.at(i, k) * b.at(k, j);  
-      }
-    } 
-  }
+  gemm::Multiply<M, L, N, K>::apply(a.raw().data(), b.raw().data(), result.raw().data());
   return result;
 }
 
-template <size_t M, size_t N, typename K>
-Matrix<M, N, K> 
-operator%(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
-  Matrix<M, N, K> result;
-  for (size_t i = 0; i < M; i++) {
-    for (size_t j = 0; j < N; j++) {
-      result.at(i, j) += a.at(i, j) * b.at(i, j);  
-    } 
-  }
+// y = A * x
+template <size_t M, size_t N, typename K, typename SA, typename SX>
+ColVector<M, K>
+gemv(Matrix<M, N, K, SA> const& a, Matrix<N, 1, K, SX> const& x) {
+  ColVector<M, K> result;
+  gemm::gemv(M, N, (K)1, a.raw().data(), N, x.raw().data(), result.raw().data());
   return result;
 }
 
+// y = A' * x, reading A in place rather than forming A.transpose()
+template <size_t M, size_t N, typename K, typename SA, typename SX>
+ColVector<N, K>
+gemv_t(Matrix<M, N, K, SA> const& a, Matrix<M, 1, K, SX> const& x) {
+  ColVector<N, K> result;
+  gemm::gemvT(M, N, (K)1, a.raw().data(), N, x.raw().data(), result.raw().data());
+  return result;
+}
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename SA, typename SB>
 bool
-operator==(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
+operator==(Matrix<M, N, K, SA> const& a, Matrix<M, N, K, SB> const& b) {
   bool result = true;
   for (size_t i = 0; i < M; i++) {
     for (size_t j = 0; j < N; j++) {
@@ -271,9 +311,9 @@ operator==(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
   return result;
 }
 
-template <size_t M, size_t N, typename K>
+template <size_t M, size_t N, typename K, typename SA, typename SB>
 bool
-operator!=(Matrix<M, N, K> a, Matrix<M, N, K> const& b) {
+operator!=(Matrix<M, N, K, SA> const& a, Matrix<M, N, K, SB> const& b) {
   return !(a == b);
 }
 
@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_MEMORY_H
+#define INCLUDED_MEMORY_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Everything big enough to live on the heap is aligned to a cache line, 
+// which is also enough for any SIMD load we use
+const size_t Alignment = 64;
+
+inline void*
+alignedAlloc(size_t bytes) {
+  void* p = 0;
+  if (posix_memalign(&p, Alignment, bytes ? bytes : Alignment) != 0) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+inline void
+alignedFree(void* p) {
+  free(p);
+}
+
+//------------------------------------------------------------------------------
+// A cache-line aligned, heap allocated array of (trivially copyable) K
+// whose size is fixed at construction.  Move only - copies must be explicit.
+template <typename K>
+struct AlignedArray {
+  AlignedArray()
+  : data_(0), size_(0) {}
+
+  explicit AlignedArray(size_t size)
+  : data_(static_cast<K*>(alignedAlloc(size * sizeof(K)))), size_(size) {}
+
+  AlignedArray(AlignedArray&& a)
+  : data_(a.data_), size_(a.size_) {
+    a.data_ = 0;
+    a.size_ = 0;
+  }
+
+  AlignedArray& operator=(AlignedArray&& a) {
+    std::swap(data_, a.data_);
+    std::swap(size_, a.size_);
+    return *this;
+  }
+
+  AlignedArray(const AlignedArray&)            = delete;
+  AlignedArray& operator=(const AlignedArray&) = delete;
+
+  ~AlignedArray() {
+    alignedFree(data_);
+  }
+
+  // Grow (discarding contents) to hold at least size elements
+  void reserve(size_t size) {
+    if (size > size_) {
+      *this = AlignedArray(size);
+    }
+  }
+
+  K*       data()       { return data_; }
+  const K* data() const { return data_; }
+  size_t   size() const { return size_; }
+
+  K&       operator[](size_t i)       { return data_[i]; }
+  const K& operator[](size_t i) const { return data_[i]; }
+
+private:
+  K*     data_;
+  size_t size_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_MNISTDATA_H
+#define INCLUDED_MNISTDATA_H
+
+#ifndef INCLUDED_IDXDATASET_H
+#include "IdxDataset.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// MNIST images and labels, as structure-of-arrays: every image's pixels 
+// back to back in one flat buffer, and every label in another.  The buffers
+// are the mapped IDX files themselves (see IdxDataset.h), so nothing is 
+// copied or allocated per image, at load time or while iterating - images
+// are handed out as views.
+struct MnistData {
+  typedef ByteSpan Image;
+  typedef uint8_t  Label;
+
+  struct Sample {
+    Image image;
+    Label label;
+  };
+
+  MnistData(const std::string& imageFile, const std::string& labelFile)
+  : data_ (imageFile, labelFile) {
+  }
+
+  size_t size() const { return data_.size(); }
+  size_t rows() const { return data_.rows(); }
+  size_t cols() const { return data_.cols(); }
+
+  // Bytes per image
+  size_t stride() const { return data_.images().stride(); }
+
+  // Index-based access
+  Image  image(size_t i) const { return data_.image(i); }
+  Label  label(size_t i) const { return data_.label(i); }
+  Sample operator[](size_t i) const { return Sample{image(i), label(i)}; }
+
+  // The pixels of images first ... first + count - 1, which are contiguous,
+  // and their labels
+  ByteSpan pixels(size_t first, size_t count) const {
+    return ByteSpan(image(first).data(), count*stride());
+  }
+
+  ByteSpan labels(size_t first, size_t count) const {
+    return ByteSpan(data_.labels().all().data() + first, count);
+  }
+
+  // Range-based access: for (const auto& sample : data) { ... }
+  struct Iterator {
+    const MnistData* data;
+    size_t           i;
+
+    Sample    operator*()  const               { return (*data)[i]; }
+    Iterator& operator++()                     { i++; return *this; }
+    bool      operator!=(const Iterator& other) const { return i != other.i; }
+  };
+
+  Iterator begin() const { return Iterator{this, 0}; }
+  Iterator end()   const { return Iterator{this, size()}; }
+
+  // Do something for each image and label
+  template <typename F>
+  void each(F f) const { 
+    for (size_t i = 0; i < size(); i++) {
+      f(image(i), label(i));
+    }
+  }
+
+private:
+  IdxDataset data_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
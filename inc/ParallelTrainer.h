@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_PARALLELTRAINER_H
+#define INCLUDED_PARALLELTRAINER_H
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_THREADPOOL_H
+#include "ThreadPool.h"
+#endif
+
+#include <vector>
+#include <memory>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Copy S columns of a batch, starting at column first, into a shard (and
+// back again)
+template <size_t R, size_t B, size_t S>
+void gatherColumns(const Matrix<R, B, float>& batch, size_t first, Matrix<R, S, float>& shard) {
+  const float* from = batch.raw().data() + first;
+  float*       to   = shard.raw().data();
+  for (size_t i = 0; i < R; i++, from += B, to += S) {
+    std::copy(from, from + S, to);
+  }
+}
+
+template <size_t R, size_t B, size_t S>
+void scatterColumns(const Matrix<R, S, float>& shard, size_t first, Matrix<R, B, float>& batch) {
+  const float* from = shard.raw().data();
+  float*       to   = batch.raw().data() + first;
+  for (size_t i = 0; i < R; i++, from += S, to += B) {
+    std::copy(from, from + S, to);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Data-parallel mini-batch training.  Each batch is cut into shards of 
+// Shard samples, the shards are spread over the threads of a pool, and every
+// thread accumulates the gradient of its shards against the shared (and 
+// unchanging) network.  The per-thread gradients are then summed pairwise
+// in a tree, and applied to the network as one averaged update.
+//
+// The result is the same update as Network::gradientBatch over the whole
+// batch followed by Network::apply - only the order of the sums differs.
+template <typename Network, size_t Shard = 16>
+struct ParallelTrainer {
+  typedef typename Network::Gradient Gradient;
+
+  template <size_t B> using InputBatch  = typename Network::template InputBatch<B>;
+  template <size_t B> using OutputBatch = typename Network::template OutputBatch<B>;
+
+  ParallelTrainer(Network& network, size_t threads = std::thread::hardware_concurrency())
+  : network_ (network)
+  , pool_    (threads) {
+    for (size_t i = 0; i < pool_.size(); i++) {
+      gradients_.emplace_back(new Gradient());
+    }
+  }
+
+  // Train on one batch, returning the loss of each sample
+  template <size_t B>
+  OutputBatch<B>
+  learnBatch(const InputBatch<B>& input, const OutputBatch<B>& target, float learningRate = 0.1f) {
+    static_assert(B % Shard == 0, "batch size must be a multiple of the shard size");
+    const size_t shards  = B/Shard;
+    const size_t workers = std::min(pool_.size(), shards);
+
+    // Each worker owns a gradient, and a contiguous run of shards
+    OutputBatch<B> loss;
+    pool_.parallel(workers, [&](size_t w) {
+      Gradient& gradient = *gradients_[w];
+      gradient.clear();
+
+      InputBatch<Shard>  x;
+      OutputBatch<Shard> t;
+      for (size_t s = w*shards/workers; s < (w + 1)*shards/workers; s++) {
+        gatherColumns(input,  s*Shard, x);
+        gatherColumns(target, s*Shard, t);
+        const auto result = network_.gradientBatch(x, t, gradient);
+        scatterColumns(std::get<1>(result), s*Shard, loss);
+      }
+    });
+
+    // Tree reduction into the first gradient - log2(workers) rounds
+    for (size_t stride = 1; stride < workers; stride *= 2) {
+      pool_.parallel((workers + 2*stride - 1)/(2*stride), [&](size_t p) {
+        const size_t i = p*2*stride;
+        if (i + stride < workers) {
+          *gradients_[i] += *gradients_[i + stride];
+        }
+      });
+    }
+
+    network_.apply(*gradients_[0], learningRate/B);
+    return loss;
+  }
+
+  size_t threads() const {
+    return pool_.size();
+  }
+
+private:
+  Network&                               network_;
+  ThreadPool                             pool_;
+  std::vector<std::unique_ptr<Gradient>> gradients_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_PIPELINE_H
+#define INCLUDED_PIPELINE_H
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_SPSCRING_H
+#include "SpscRing.h"
+#endif
+
+#include <atomic>
+#include <thread>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// One thread per layer: each stage pops its layer's input from one ring,
+// and pushes the layer's output onto the next.  A stage owns the ring 
+// between its layer and the rest of the network.
+template <typename Network>
+struct Stage;
+
+template <typename InputLayer, typename...HiddenLayers>
+struct Stage<FeedForwardNetwork<InputLayer, HiddenLayers...>> {
+  typedef FeedForwardNetwork<InputLayer, HiddenLayers...> Network;
+  typedef FeedForwardNetwork<HiddenLayers...>             Remain;
+
+  Stage(Network&                                  network,
+        SpscRing<typename Network::Input>&        input,
+        SpscRing<typename Network::Output>&       output,
+        size_t                                    capacity,
+        std::atomic<bool>&                        stop)
+  : layer_  (network.getLayer())
+  , input_  (input)
+  , stop_   (stop)
+  , ring_   (capacity)
+  , next_   (network.getRemainNetwork(), ring_, output, capacity, stop)
+  , thread_ ([this] { run(); }) {
+  }
+
+  ~Stage() {
+    thread_.join();
+  }
+
+private:
+  void run() {
+    typename InputLayer::Input x;
+    while (input_.pop(x, stop_) && ring_.push(layer_.infer(x), stop_)) {}
+  }
+
+  const InputLayer&                          layer_;
+  SpscRing<typename InputLayer::Input>&      input_;
+  std::atomic<bool>&                         stop_;
+  SpscRing<typename InputLayer::Output>      ring_;
+  Stage<Remain>                              next_;
+  std::thread                                thread_;
+};
+
+// The last stage pushes straight onto the pipeline's output ring, so it has
+// no ring of its own to size
+template <typename OutputLayer>
+struct Stage<FeedForwardNetwork<OutputLayer>> {
+  typedef FeedForwardNetwork<OutputLayer> Network;
+
+  Stage(Network&                                  network,
+        SpscRing<typename Network::Input>&        input,
+        SpscRing<typename Network::Output>&       output,
+        size_t                                    /*capacity*/,
+        std::atomic<bool>&                        stop)
+  : layer_  (network.getLayer())
+  , input_  (input)
+  , output_ (output)
+  , stop_   (stop)
+  , thread_ ([this] { run(); }) {
+  }
+
+  ~Stage() {
+    thread_.join();
+  }
+
+private:
+  void run() {
+    typename OutputLayer::Input x;
+    while (input_.pop(x, stop_) && output_.push(layer_.infer(x), stop_)) {}
+  }
+
+  const OutputLayer&                         layer_;
+  SpscRing<typename OutputLayer::Input>&     input_;
+  SpscRing<typename OutputLayer::Output>&    output_;
+  std::atomic<bool>&                         stop_;
+  std::thread                                thread_;
+};
+
+//------------------------------------------------------------------------------
+// Streaming inference, pipelined across the layers of a network: while 
+// sample k is in layer 2, sample k + 1 is already in layer 1.  Outputs come
+// out in the order inputs went in.  One thread may push while another pops.
+//
+// The network must not be trained while a pipeline is running over it.
+// Destroying the pipeline stops the stages, dropping anything in flight.
+template <typename Network>
+struct Pipeline {
+  typedef typename Network::Input  Input;
+  typedef typename Network::Output Output;
+
+  explicit Pipeline(Network& network, size_t capacity = 64)
+  : stop_   (false)
+  , input_  (capacity)
+  , output_ (capacity)
+  , stages_ (network, input_, output_, capacity, stop_) {
+  }
+
+  ~Pipeline() {
+    stop_.store(true);
+  }
+
+  // Queue an input, waiting while the pipeline is full
+  void push(const Input& input) {
+    input_.push(input, stop_);
+  }
+
+  bool tryPush(const Input& input) {
+    return input_.tryPush(input);
+  }
+
+  // Take the next output, waiting until there is one
+  Output pop() {
+    Output output;
+    output_.pop(output, stop_);
+    return output;
+  }
+
+  bool tryPop(Output& output) {
+    return output_.tryPop(output);
+  }
+
+private:
+  std::atomic<bool> stop_;
+  SpscRing<Input>   input_;
+  SpscRing<Output>  output_;
+  Stage<Network>    stages_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_PREFETCHER_H
+#define INCLUDED_PREFETCHER_H
+
+#ifndef INCLUDED_SPSCRING_H
+#include "SpscRing.h"
+#endif
+
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <limits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Prepares batches on a background thread while the caller trains on the
+// last one.  produce(batch) fills in a batch - shuffling, decoding,
+// normalizing, corrupting, whatever the training loop needs - and returns
+// false once there is nothing left.  Batches live in a fixed set of slots
+// (two for double buffering, three for triple buffering) that go around
+// between the two threads, so nothing is allocated or copied per batch.
+template <typename Batch>
+struct Prefetcher {
+  typedef std::function<bool (Batch&)> Producer;
+
+  explicit Prefetcher(Producer produce, size_t slots = 3)
+  : produce_ (produce)
+  , slots_   (slots)
+  , free_    (slots)
+  , ready_   (slots)
+  , current_ (None)
+  , stalls_  (0)
+  , done_    (false)
+  , stop_    (false) {
+    for (size_t i = 0; i < slots; i++) {
+      free_.tryPush(i);
+    }
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ~Prefetcher() {
+    stop_.store(true);
+    thread_.join();
+  }
+
+  Prefetcher(const Prefetcher&)            = delete;
+  Prefetcher& operator=(const Prefetcher&) = delete;
+
+  // The next batch, or nullptr when the producer is done.  The previous
+  // batch goes back to the producer, so is no longer valid.
+  const Batch* next() {
+    if (current_ != None) {
+      free_.tryPush(current_);
+      current_ = None;
+    }
+
+    size_t slot = Done;
+    if (done_) return nullptr;
+    if (!ready_.tryPop(slot)) {
+      stalls_++;
+      ready_.pop(slot, stop_);
+    }
+    if (slot == Done) {
+      done_ = true;
+      return nullptr;
+    }
+
+    current_ = slot;
+    return &slots_[slot];
+  }
+
+  // How often next() had to wait for the producer
+  size_t stalls() const { return stalls_; }
+
+private:
+  static const size_t None = std::numeric_limits<size_t>::max();
+  static const size_t Done = None - 1;
+
+  void run() {
+    size_t slot;
+    while (free_.pop(slot, stop_)) {
+      if (!produce_(slots_[slot])) {
+        ready_.push(size_t(Done), stop_);
+        return;
+      }
+      if (!ready_.push(slot, stop_)) return;
+    }
+  }
+
+  Producer            produce_;
+  std::vector<Batch>  slots_;
+  SpscRing<size_t>    free_;
+  SpscRing<size_t>    ready_;
+  size_t              current_;
+  size_t              stalls_;
+  bool                done_;
+  std::atomic<bool>   stop_;
+  std::thread         thread_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,318 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_QUANTIZED_H
+#define INCLUDED_QUANTIZED_H
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_SIMD_H
+#include "Simd.h"
+#endif
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// 8-bit inference.  Weights are stored as int8 with one scale per row, so
+// a row with small weights keeps its precision.  Each layer's input is 
+// quantized on the way in, with a scale and zero point calibrated from
+// sample inputs, to 7-bit unsigned values: that way a pair of u8*s8 
+// products can never saturate vpmaddubsw's 16-bit sums, and every kernel
+// below gives exactly the same integers.  Biases and activations stay
+// float.
+namespace quantized {
+
+// Input values, quantized: q = clamp(round(x/scale) + zero, 0, 127)
+const int InputLevels = 127;
+
+// Rows are padded to a multiple of this many bytes (with zero weights)
+const size_t RowAlignment = 32;
+
+constexpr size_t
+paddedLength(size_t n) {
+  return (n + RowAlignment - 1)/RowAlignment*RowAlignment;
+}
+
+// y[i] = x . a[i] for rows i < m of n (a multiple of RowAlignment) bytes 
+inline void
+dotKernel(size_t m, size_t n, const int8_t* a, const uint8_t* x, int32_t* y) {
+#ifdef ROOK_AVX2
+  // Four rows at a time, so each load of x feeds four rows
+  const size_t m4 = m - m%4;
+  const __m256i ones = _mm256_set1_epi16(1);
+  auto dot = [&](__m256i acc, __m256i xv, const int8_t* row) -> __m256i {
+    const __m256i w = _mm256_load_si256((const __m256i*)row);
+#if defined(__AVXVNNI__) || (defined(__AVX512VNNI__) && defined(__AVX512VL__))
+    (void)ones;
+    return _mm256_dpbusd_epi32(acc, xv, w);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(xv, w), ones));
+#endif
+  };
+  auto hsum = [](__m256i v) -> int32_t {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+  };
+
+  for (size_t i = 0; i < m4; i += 4) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    __m256i s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+    for (size_t j = 0; j < n; j += 32) {
+      const __m256i xv = _mm256_load_si256((const __m256i*)(x + j));
+      s0 = dot(s0, xv, a + (i + 0)*n + j);
+      s1 = dot(s1, xv, a + (i + 1)*n + j);
+      s2 = dot(s2, xv, a + (i + 2)*n + j);
+      s3 = dot(s3, xv, a + (i + 3)*n + j);
+    }
+    y[i + 0] = hsum(s0);
+    y[i + 1] = hsum(s1);
+    y[i + 2] = hsum(s2);
+    y[i + 3] = hsum(s3);
+  }
+  for (size_t i = m4; i < m; i++) {
+    __m256i s = _mm256_setzero_si256();
+    for (size_t j = 0; j < n; j += 32) {
+      s = dot(s, _mm256_load_si256((const __m256i*)(x + j)), a + i*n + j);
+    }
+    y[i] = hsum(s);
+  }
+#else
+  for (size_t i = 0; i < m; i++) {
+    int32_t s = 0;
+    for (size_t j = 0; j < n; j++) {
+      s += (int32_t)x[j] * a[i*n + j];
+    }
+    y[i] = s;
+  }
+#endif
+}
+
+} // namespace quantized
+
+//------------------------------------------------------------------------------
+// The smallest and largest value seen at each of a layer's inputs, over 
+// all the calibration samples
+struct Range {
+  Range() 
+  : low  ( std::numeric_limits<float>::max())
+  , high (-std::numeric_limits<float>::max()) {}
+
+  void add(const float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      low  = std::min(low,  x[i]);
+      high = std::max(high, x[i]);
+    }
+  }
+
+  float low;
+  float high;
+};
+
+//------------------------------------------------------------------------------
+// A Layer's weights as int8, one scale per row, and its input's calibrated
+// quantization.  Inference is the integer product, rescaled, plus the 
+// float bias, through the float activation.
+template <typename Layer>
+struct QuantizedLayer;
+
+template <size_t X, size_t Y, typename Activation, typename Loss>
+struct QuantizedLayer<Layer<X, Y, Activation, Loss>> {
+  typedef typename Layer<X, Y, Activation, Loss>::Input  Input;
+  typedef typename Layer<X, Y, Activation, Loss>::Output Output;
+
+  static const size_t Stride = quantized::paddedLength(X);
+
+  QuantizedLayer(const Layer<X, Y, Activation, Loss>& layer, const Range& input)
+  : weights_ (Y*Stride) {
+    std::fill(weights_.data(), weights_.data() + Y*Stride, 0);
+
+    // Inputs: 0 must be representable exactly, so padding and zeros cost
+    // nothing
+    const float low  = std::min(input.low, 0.0f);
+    const float high = std::max(input.high, low + 1.0e-6f);
+    inputScale_ = (high - low)/quantized::InputLevels;
+    zero_       = (int32_t)std::lround(-low/inputScale_);
+
+    const auto& w = layer.getWeightMatrix();
+    for (size_t i = 0; i < Y; i++) {
+      float largest = 0.0f;
+      for (size_t j = 0; j < X; j++) {
+        largest = std::max(largest, std::fabs(w.at(i, j)));
+      }
+      const float scale = largest > 0.0f ? largest/127.0f : 1.0f;
+      int32_t sum = 0;
+      for (size_t j = 0; j < X; j++) {
+        const int8_t q = (int8_t)std::max(-127L, std::min(127L, std::lround(w.at(i, j)/scale)));
+        weights_[i*Stride + j] = q;
+        sum += q;
+      }
+      // y = inputScale * scale * (x . w - zero * sum(w)) + bias
+      multiplier_.at(i) = inputScale_ * scale;
+      offset_.at(i)     = layer.getBias().at(i) - multiplier_.at(i) * zero_ * sum;
+    }
+  }
+
+  Output infer(Input const& input) const {
+    // Quantize the input, zero padded to a whole number of vectors
+    alignas(32) uint8_t q[Stride] = {};
+    const float  inv = 1.0f/inputScale_;
+    const float* x   = input.raw().data();
+    for (size_t j = 0; j < X; j++) {
+      const float v = std::min(std::max(x[j]*inv + zero_, 0.0f), (float)quantized::InputLevels);
+      q[j] = (uint8_t)(v + 0.5f);
+    }
+
+    int32_t dots[Y];
+    quantized::dotKernel(Y, Stride, weights_.data(), q, dots);
+
+    Output output;
+    for (size_t i = 0; i < Y; i++) {
+      output.at(i) = dots[i]*multiplier_.at(i) + offset_.at(i);
+    }
+    Activation::activate(output.raw().data(), output.raw().data(), Y);
+    return output;
+  }
+
+  // Bytes of weights (int8) and per-row constants
+  size_t weightBytes() const {
+    return Y*Stride + sizeof(multiplier_) + sizeof(offset_);
+  }
+
+  const int8_t* weights()    const { return weights_.data(); }
+  float         inputScale() const { return inputScale_; }
+  int32_t       zero()       const { return zero_; }
+
+private:
+  AlignedArray<int8_t> weights_;
+  Output               multiplier_;
+  Output               offset_;
+  float                inputScale_;
+  int32_t              zero_;
+};
+
+//------------------------------------------------------------------------------
+// A whole FeedForwardNetwork, quantized layer by layer.  The calibration 
+// samples go through the float network once, recording the range of every
+// layer's input.  infer() keeps its quantized input on the stack, so any
+// number of threads can share one QuantizedNetwork.
+template <typename Network>
+struct QuantizedNetwork;
+
+template <typename InputLayer, typename...HiddenLayers>
+struct QuantizedNetwork<FeedForwardNetwork<InputLayer, HiddenLayers...>> {
+  typedef FeedForwardNetwork<InputLayer, HiddenLayers...> Network;
+  typedef typename Network::Input                         Input;
+  typedef typename Network::Output                        Output;
+
+  QuantizedNetwork(const Network& network, const std::vector<Input>& samples)
+  : QuantizedNetwork(network, samples, range(samples)) {}
+
+  Output infer(Input const& input) const {
+    return remain_.infer(layer_.infer(input));
+  }
+
+  size_t weightBytes() const {
+    return layer_.weightBytes() + remain_.weightBytes();
+  }
+
+private:
+  typedef QuantizedNetwork<FeedForwardNetwork<HiddenLayers...>> Remain;
+  typedef std::vector<typename InputLayer::Output>              Next;
+
+  static Range range(const std::vector<Input>& samples) {
+    Range range;
+    for (const auto& sample : samples) {
+      range.add(sample.raw().data(), InputLayer::Input::rows);
+    }
+    return range;
+  }
+
+  QuantizedNetwork(const Network& network, const std::vector<Input>& samples, const Range& input)
+  : layer_  (network.getLayer(), input)
+  , remain_ (network.getRemainNetwork(), next(network.getLayer(), samples)) {}
+
+  // Calibrate the next layer on the float outputs of this one
+  static Next next(const InputLayer& layer, const std::vector<Input>& samples) {
+    Next outputs;
+    outputs.reserve(samples.size());
+    for (const auto& sample : samples) {
+      outputs.push_back(layer.infer(sample));
+    }
+    return outputs;
+  }
+
+  QuantizedLayer<InputLayer> layer_;
+  Remain                     remain_;
+};
+
+template <typename OutputLayer>
+struct QuantizedNetwork<FeedForwardNetwork<OutputLayer>> {
+  typedef FeedForwardNetwork<OutputLayer> Network;
+  typedef typename Network::Input         Input;
+  typedef typename Network::Output        Output;
+
+  QuantizedNetwork(const Network& network, const std::vector<Input>& samples)
+  : layer_ (network.getLayer(), range(samples)) {}
+
+  Output infer(Input const& input) const {
+    return layer_.infer(input);
+  }
+
+  size_t weightBytes() const {
+    return layer_.weightBytes();
+  }
+
+private:
+  static Range range(const std::vector<Input>& samples) {
+    Range range;
+    for (const auto& sample : samples) {
+      range.add(sample.raw().data(), OutputLayer::Input::rows);
+    }
+    return range;
+  }
+
+  QuantizedLayer<OutputLayer> layer_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,261 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_RANDOM_H
+#define INCLUDED_RANDOM_H
+
+#ifndef INCLUDED_VECTORMATH_H
+#include "VectorMath.h"
+#endif
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <atomic>
+#include <cstdlib>
+#include <random>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// xoshiro256** (Blackman & Vigna): small, fast, and good enough for 
+// shuffling and sampling.  The same seed always gives the same stream, on
+// any platform.  Meets the UniformRandomBitGenerator requirements, so the
+// <random> distributions take it too.
+struct Random {
+  typedef uint64_t result_type;
+
+  explicit Random(uint64_t seed = 0x853c49e6748fea9bULL) {
+    this->seed(seed);
+  }
+
+  // Expand the seed with splitmix64, so that nearby seeds give unrelated
+  // streams
+  void seed(uint64_t seed) {
+    for (auto& s : state_) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      s = z ^ (z >> 31);
+    }
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()() {
+    const uint64_t result = rotate(state_[1] * 5, 7) * 9;
+    const uint64_t t      = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3]  = rotate(state_[3], 45);
+    return result;
+  }
+
+  // Uniform on [0, n), without the bias of %
+  uint64_t below(uint64_t n) {
+    uint64_t x = (*this)();
+    __uint128_t m = (__uint128_t)x * n;
+    uint64_t low = (uint64_t)m;
+    if (low < n) {
+      const uint64_t threshold = -n % n;
+      while (low < threshold) {
+        x   = (*this)();
+        m   = (__uint128_t)x * n;
+        low = (uint64_t)m;
+      }
+    }
+    return (uint64_t)(m >> 64);
+  }
+
+  // Uniform on [0, 1)
+  float uniform() {
+    return ((*this)() >> 40) * (1.0f/16777216.0f);
+  }
+
+  // Fisher-Yates shuffle of first ... last
+  template <typename Iterator>
+  void shuffle(Iterator first, Iterator last) {
+    for (size_t n = last - first; n > 1; n--) {
+      std::swap(first[n - 1], first[below(n)]);
+    }
+  }
+
+private:
+  static uint64_t rotate(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t state_[4];
+};
+
+//------------------------------------------------------------------------------
+// Every weight matrix (or generator), and every thread's threadRandom()
+// stream, is seeded from a seed of its own, taken in turn from a sequence.
+// The sequence starts from seedInitialization() or the ROOK_SEED 
+// environment variable if either is used - so a program sets up the same 
+// weights and noise every run - and from std::random_device if not.
+inline std::atomic<uint64_t>&
+initializationSeeds() {
+  static std::atomic<uint64_t> seeds([] {
+    if (const char* seed = std::getenv("ROOK_SEED")) {
+      return (uint64_t)std::strtoull(seed, nullptr, 0);
+    }
+    std::random_device device;
+    return ((uint64_t)device() << 32) ^ device();
+  }());
+  return seeds;
+}
+
+inline void
+seedInitialization(uint64_t seed) {
+  initializationSeeds().store(seed);
+}
+
+inline uint64_t
+nextSeed() {
+  return initializationSeeds()++;
+}
+
+//------------------------------------------------------------------------------
+// A counter-based generator: number n of a stream is a hash of the stream's
+// key and n, so there is no state to share but a counter.  Every thread 
+// can have a stream of its own, and a whole vector of numbers comes out of
+// one pass of SIMD integer arithmetic.  The hash is two keyed rounds of 
+// Wellons' lowbias32 - not cryptographic, but plenty for noise and masks.
+struct CounterRandom {
+  explicit CounterRandom(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0)
+  : counter_ (0) {
+    Random keys(seed ^ (stream * 0x9e3779b97f4a7c15ULL));
+    const uint64_t key = keys();
+    key0_ = (uint32_t)key;
+    key1_ = (uint32_t)(key >> 32);
+  }
+
+  // The next V::width numbers, uniform on [0, 1) and (0, 1]
+  template <typename V>
+  typename V::F uniform() {
+    return V::mul(V::convert(V::template ishr<8>(next<V>())), V::set(1.0f/16777216.0f));
+  }
+
+  template <typename V>
+  typename V::F uniformOpen() {
+    const typename V::I mantissa = V::iadd(V::template ishr<8>(next<V>()), V::iset(1));
+    return V::mul(V::convert(mantissa), V::set(1.0f/16777216.0f));
+  }
+
+  // The next V::width pairs of standard normal numbers (Box-Muller)
+  template <typename V>
+  void normal(typename V::F& z0, typename V::F& z1) {
+    const typename V::F u = uniformOpen<V>();
+    const typename V::F v = uniform<V>();
+    const typename V::F r = V::sqrt(V::mul(V::set(-2.0f), math::log<V>(u)));
+    typename V::F s, c;
+    math::sincos<V>(V::mul(v, V::set(6.28318530717958648f)), s, c);
+    z0 = V::mul(r, c);
+    z1 = V::mul(r, s);
+  }
+
+  // Fill out[0] ... out[n - 1]
+  void uniform(float* out, size_t n) {
+    typedef math::Native V;
+    fill<V>(out, n, [this](float* p) { V::store(p, uniform<V>()); }, V::width);
+  }
+
+  void normal(float* out, size_t n, float mean = 0.0f, float deviation = 1.0f) {
+    typedef math::Native V;
+    fill<V>(out, n, [&](float* p) { 
+      typename V::F z0, z1;
+      normal<V>(z0, z1);
+      V::store(p,            V::fma(z0, V::set(deviation), V::set(mean)));
+      V::store(p + V::width, V::fma(z1, V::set(deviation), V::set(mean)));
+    }, 2*V::width);
+  }
+
+  uint64_t counter() const { return counter_; }
+
+private:
+  template <typename V>
+  typename V::I next() {
+    typedef typename V::I I;
+    // The high half of the counter picks a key for each 2^32 numbers
+    const uint32_t key0 = key0_ + (uint32_t)(counter_ >> 32)*0x9e3779b9u;
+    I x = V::iadd(V::iset((int32_t)(uint32_t)counter_), V::iramp());
+    x = round<V>(V::ixor(x, V::iset((int32_t)key0)));
+    x = round<V>(V::ixor(x, V::iset((int32_t)key1_)));
+    counter_ += V::width;
+    return x;
+  }
+
+  template <typename V>
+  static typename V::I round(typename V::I x) {
+    x = V::ixor(x, V::template ishr<16>(x));
+    x = V::imul(x, V::iset(0x7feb352d));
+    x = V::ixor(x, V::template ishr<15>(x));
+    x = V::imul(x, V::iset((int32_t)0x846ca68bu));
+    return V::ixor(x, V::template ishr<16>(x));
+  }
+
+  // Whole blocks straight into out, and the tail through a buffer
+  template <typename V, typename F>
+  static void fill(float* out, size_t n, F block, size_t size) {
+    size_t i = 0;
+    for (; i + size <= n; i += size) {
+      block(out + i);
+    }
+    if (i < n) {
+      float tail[2*V::width];
+      block(tail);
+      std::copy(tail, tail + (n - i), out + i);
+    }
+  }
+
+  uint64_t counter_;
+  uint32_t key0_;
+  uint32_t key1_;
+};
+
+// Each thread's own stream, seeded from the sequence when the thread first
+// asks for one
+inline CounterRandom&
+threadRandom() {
+  thread_local CounterRandom random(nextSeed());
+  return random;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_SAMPLER_H
+#define INCLUDED_SAMPLER_H
+
+#ifndef INCLUDED_RANDOM_H
+#include "Random.h"
+#endif
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// The order samples are visited in, reshuffled every epoch.  The order for
+// epoch e depends only on the seed and e, so runs are reproducible and an
+// epoch can be replayed on its own.
+//
+// With a block size, whole blocks of consecutive samples are shuffled, and 
+// then the samples within each block: batches still mix the dataset, but
+// reads walk a memory-mapped file a block at a time rather than hopping
+// about it.
+struct EpochSampler {
+  explicit EpochSampler(size_t count, uint64_t seed = 1, size_t block = 0)
+  : seed_    (seed)
+  , block_   (block)
+  , epoch_   (0)
+  , order_   (count) {
+    shuffle();
+  }
+
+  size_t size()  const { return order_.size(); }
+  size_t epoch() const { return epoch_; }
+
+  // Move on to the order for the given epoch
+  void epoch(size_t e) {
+    epoch_ = e;
+    shuffle();
+  }
+
+  void next() {
+    epoch(epoch_ + 1);
+  }
+
+  // The i'th sample of this epoch
+  size_t operator[](size_t i) const { return order_[i]; }
+
+  // The samples of batch b, of B at a time - there are size()/B whole 
+  // batches
+  const size_t* batch(size_t b, size_t B) const {
+    return order_.data() + b*B;
+  }
+
+  const std::vector<size_t>& order() const { return order_; }
+
+private:
+  void shuffle() {
+    Random random(seed_ ^ (epoch_ * 0x9e3779b97f4a7c15ULL));
+    std::iota(order_.begin(), order_.end(), size_t(0));
+    if (block_ == 0 || block_ >= order_.size()) {
+      random.shuffle(order_.begin(), order_.end());
+      return;
+    }
+
+    const size_t blocks = (order_.size() + block_ - 1)/block_;
+    std::vector<size_t> starts(blocks);
+    for (size_t b = 0; b < blocks; b++) {
+      starts[b] = b*block_;
+    }
+    random.shuffle(starts.begin(), starts.end());
+
+    auto out = order_.begin();
+    for (auto start : starts) {
+      const size_t end = std::min(start + block_, order_.size());
+      auto first = out;
+      for (size_t i = start; i < end; i++) {
+        *out++ = i;
+      }
+      random.shuffle(first, out);
+    }
+  }
+
+  uint64_t            seed_;
+  size_t              block_;
+  size_t              epoch_;
+  std::vector<size_t> order_;
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
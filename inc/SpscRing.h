@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_SPSCRING_H
+#define INCLUDED_SPSCRING_H
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// Waiting on another thread: spin briefly, then yield, then sleep, so that a
+// busy stream costs no system calls and an idle one costs no cores
+struct Backoff {
+  Backoff() : count_(0) {}
+
+  void wait() {
+    if (count_ < 64) {
+      count_++;
+    } else if (count_ < 128) {
+      count_++;
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+private:
+  unsigned count_;
+};
+
+//------------------------------------------------------------------------------
+// Bounded single-producer/single-consumer queue.  The producer only writes
+// tail_ and the consumer only writes head_, each on its own cache line, so
+// the two sides never contend for anything but the slots themselves.
+template <typename T>
+struct SpscRing {
+  explicit SpscRing(size_t capacity)
+  : slots_ (capacity + 1)
+  , head_  (0)
+  , tail_  (0) {
+  }
+
+  bool tryPush(const T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t next = advance(tail);
+    if (next == head_.load(std::memory_order_acquire)) return false;
+    slots_[tail] = value;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T& value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    value = slots_[head];
+    head_.store(advance(head), std::memory_order_release);
+    return true;
+  }
+
+  // Blocking versions - give up (and return false) once stop is set
+  bool push(const T& value, const std::atomic<bool>& stop) {
+    for (Backoff backoff; !tryPush(value); backoff.wait()) {
+      if (stop.load(std::memory_order_relaxed)) return false;
+    }
+    return true;
+  }
+
+  bool pop(T& value, const std::atomic<bool>& stop) {
+    for (Backoff backoff; !tryPop(value); backoff.wait()) {
+      if (stop.load(std::memory_order_relaxed)) return false;
+    }
+    return true;
+  }
+
+private:
+  size_t advance(size_t i) const {
+    return i + 1 == slots_.size() ? 0 : i + 1;
+  }
+
+  std::vector<T>      slots_;
+  char                pad0_[64];
+  std::atomic<size_t> head_;
+  char                pad1_[64];
+  std::atomic<size_t> tail_;
+  char                pad2_[64];
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
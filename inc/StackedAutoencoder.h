@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_STACKEDAUTOENCODER_H
+#define INCLUDED_STACKEDAUTOENCODER_H
+
+#ifndef INCLUDED_AUTOENCODER_H
+#include "Autoencoder.h"
+#endif
+
+#ifndef INCLUDED_FEEDFORWARDNETWORK_H
+#include "FeedForwardNetwork.h"
+#endif
+
+#ifndef INCLUDED_ENCODING_H
+#include "Encoding.h"
+#endif
+
+#ifndef INCLUDED_SAMPLER_H
+#include "Sampler.h"
+#endif
+
+#include <memory>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// How to pretrain each level of a StackedAutoencoder.  With a cache 
+// directory, each level's codes go to a mapped file there (codes-1.bin,
+// codes-2.bin, ...) rather than memory.
+struct Pretraining {
+  Pretraining(size_t epochs = 1, float learningRate = 0.01f, uint64_t seed = 1, 
+              const std::string& cache = "")
+  : epochs       (epochs)
+  , learningRate (learningRate)
+  , seed         (seed)
+  , cache        (cache) {}
+
+  size_t      epochs;
+  float       learningRate;
+  uint64_t    seed;
+  std::string cache;
+};
+
+//------------------------------------------------------------------------------
+// Greedy layer-wise pretraining of a stack of autoencoders, X -> Y -> ... 
+// Autoencoder 1 learns from the data, then the whole dataset is encoded 
+// once into a cached code buffer that autoencoder 2 learns from, and so on,
+// so no sample ever goes through the lower levels more than once.  The 
+// encoders then initialize the first layers of a FeedForwardNetwork.
+template <size_t...Sizes>
+struct StackedAutoencoder;
+
+template <size_t X, size_t Y, size_t...Rest>
+struct StackedAutoencoder<X, Y, Rest...> {
+  typedef rook::Autoencoder<X, Y>        Level;
+  typedef StackedAutoencoder<Y, Rest...> Remain;
+
+  // Train every level in turn on data, which holds X features per sample
+  void pretrain(const FloatArena& data, const Pretraining& options = Pretraining(), size_t depth = 1) {
+    if (data.features() != X) {
+      throw std::invalid_argument("StackedAutoencoder: data must have as many features as the first level");
+    }
+
+    EpochSampler sampler(data.size(), options.seed + depth);
+    typename Level::Input input;
+    for (size_t epoch = 0; epoch < options.epochs; epoch++, sampler.next()) {
+      for (size_t i = 0; i < data.size(); i++) {
+        std::memcpy(input.raw().data(), data.sample(sampler[i]), X*sizeof(float));
+        level.learn(input, options.learningRate);
+      }
+    }
+
+    // Encode everything once, for the next level
+    const std::string path = options.cache.empty() ? "" : 
+                             options.cache + "/codes-" + std::to_string(depth) + ".bin";
+    codes_.reset(new FloatArena(data.size(), Y, path));
+    parallelFor(data.size(), 64, data.size()*X*Y, [&](size_t begin, size_t end) {
+      typename Level::Input x;
+      for (size_t i = begin; i < end; i++) {
+        std::memcpy(x.raw().data(), data.sample(i), X*sizeof(float));
+        const auto code = level.encode(x);
+        std::memcpy(codes_->sample(i), code.raw().data(), Y*sizeof(float));
+      }
+    });
+
+    remain.pretrain(*codes_, options, depth + 1);
+  }
+
+  // This level's codes for every sample of the data it learned from
+  const FloatArena& codes() const { return *codes_; }
+
+  // Copy the encoders into the first layers of network - the rest (e.g. an
+  // output layer) are left as they are
+  template <size_t I, size_t O, typename A, typename L, typename Next, typename...Layers>
+  void initialize(FeedForwardNetwork<Layer<I, O, A, L>, Next, Layers...>& network) const {
+    initialize(network.getLayer());
+    remain.initialize(network.getRemainNetwork());
+  }
+
+  // A network's last layer, which must be the stack's last level
+  template <size_t I, size_t O, typename A, typename L>
+  void initialize(FeedForwardNetwork<Layer<I, O, A, L>>& network) const {
+    static_assert(sizeof...(Rest) == 0, "network must have a layer for every level of the stack");
+    initialize(network.getLayer());
+  }
+
+  template <size_t I, size_t O, typename A, typename L>
+  void initialize(Layer<I, O, A, L>& layer) const {
+    static_assert(I == X && O == Y, "network layers must match the stack");
+    static_assert(std::is_same<A, Sigmoid>::value, "layers initialized from the stack must be Sigmoid, as its encoders are");
+    layer.getWeightMatrix() = level.decoder.getWeightMatrix().transpose();
+    layer.getBias()         = level.encoderBias;
+  }
+
+  Level                       level;
+  Remain                      remain;
+
+private:
+  std::unique_ptr<FloatArena> codes_;
+};
+
+template <size_t X>
+struct StackedAutoencoder<X> {
+  void pretrain(const FloatArena&, const Pretraining& = Pretraining(), size_t = 1) {}
+
+  template <typename Network>
+  void initialize(Network&) const {}
+};
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
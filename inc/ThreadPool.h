@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_THREADPOOL_H
+#define INCLUDED_THREADPOOL_H
+
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <exception>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------
+
+namespace rook { 
+
+//------------------------------------------------------------------------------
+// A fixed set of worker threads, started once and reused for every parallel
+// loop.  parallel(n, f) runs f(0) ... f(n - 1) across the workers and the
+// calling thread, and returns once they have all finished.
+//
+// Work is balanced by stealing: each thread starts with an equal, contiguous
+// share of the indices and takes them from the front; a thread that runs 
+// out takes the back half of whatever share has the most left.
+//
+// A parallel loop started from inside another one, or while some other 
+// thread is driving the pool, just runs on the calling thread - so library
+// kernels can use a shared pool without caring who called them.
+//
+// If f throws, on any thread, no further indices are started; once every
+// thread has stopped, parallel rethrows the first exception to its caller.
+struct ThreadPool {
+  // threads counts the calling thread, so ThreadPool(1) starts no workers
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+  : size_       (std::max<size_t>(threads, 1))
+  , shares_     (new Share[size_])
+  , generation_ (0)
+  , busy_       (0)
+  , stop_       (false)
+  , failed_     (false)
+  , task_       (nullptr) {
+    for (size_t i = 1; i < size_; i++) {
+      workers_.emplace_back([this, i] { work(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Number of threads that take part in a parallel loop
+  size_t size() const {
+    return size_;
+  }
+
+  template <typename F>
+  void parallel(size_t n, F f) {
+    if (n == 0) return;
+
+    std::unique_lock<std::mutex> driving(driver_, std::try_to_lock);
+    if (n == 1 || workers_.empty() || inside() || !driving.owns_lock()) {
+      for (size_t i = 0; i < n; i++) f(i);
+      return;
+    }
+
+    std::function<void (size_t)> task(f);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t t = 0; t < size_; t++) {
+        shares_[t].begin = t*n/size_;
+        shares_[t].end   = (t + 1)*n/size_;
+      }
+      task_   = &task;
+      busy_   = workers_.size();
+      failed_ = false;
+      generation_++;
+    }
+    wake_.notify_all();
+
+    run(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+      std::exception_ptr error;
+      std::swap(error, error_);
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  // A thread's remaining share of the indices, padded so that no two 
+  // shares sit on the same cache line
+  struct Share {
+    std::mutex lock;
+    size_t     begin;
+    size_t     end;
+    char       padding[64];
+  };
+
+  // Whether this thread is already running a parallel loop
+  static bool& inside() {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  // Take the next index of share t, if there is one
+  bool take(size_t t, size_t& i) {
+    std::lock_guard<std::mutex> lock(shares_[t].lock);
+    if (failed_ || shares_[t].begin == shares_[t].end) return false;
+    i = shares_[t].begin++;
+    return true;
+  }
+
+  // Move the back half of the fullest share into share t
+  bool steal(size_t t) {
+    if (failed_) return false;
+    size_t victim = t, most = 0;
+    for (size_t v = 0; v < size_; v++) {
+      std::lock_guard<std::mutex> lock(shares_[v].lock);
+      if (shares_[v].end - shares_[v].begin > most) {
+        most   = shares_[v].end - shares_[v].begin;
+        victim = v;
+      }
+    }
+    if (most == 0)     return false;
+    if (victim == t)   return true;
+
+    std::lock(shares_[t].lock, shares_[victim].lock);
+    std::lock_guard<std::mutex> mine  (shares_[t].lock,      std::adopt_lock);
+    std::lock_guard<std::mutex> theirs(shares_[victim].lock, std::adopt_lock);
+    Share& from = shares_[victim];
+    if (from.begin == from.end) return true;  // Raced - look again
+    const size_t half = (from.end - from.begin + 1)/2;
+    shares_[t].begin = from.end - half;
+    shares_[t].end   = from.end;
+    from.end        -= half;
+    return true;
+  }
+
+  void run(size_t t) {
+    inside() = true;
+    try {
+      for (;;) {
+        size_t i;
+        while (take(t, i)) {
+          (*task_)(i);
+        }
+        if (!steal(t)) break;
+      }
+    } catch (...) {
+      fail(std::current_exception());
+    }
+    inside() = false;
+  }
+
+  // Keep the first exception for the driver to rethrow, and stop every 
+  // thread taking more indices
+  void fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) error_ = error;
+    failed_ = true;
+  }
+
+  void work(size_t t) {
+    size_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+      }
+
+      run(t);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) done_.notify_one();
+    }
+  }
+
+  size_t                              size_;
+  std::unique_ptr<Share[]>            shares_;
+  std::vector<std::thread>            workers_;
+  std::mutex                          driver_;
+  std::mutex                          mutex_;
+  std::condition_variable             wake_;
+  std::condition_variable             done_;
+  size_t                              generation_;
+  size_t                              busy_;
+  bool                                stop_;
+  std::atomic<bool>                   failed_;
+  std::exception_ptr                  error_;
+  std::function<void (size_t)>*       task_;
+};
+
+//------------------------------------------------------------------------------
+// The pool shared by the library's kernels.  It starts on first use, with 
+// one thread per core, or ROOK_THREADS threads if that is set.
+inline ThreadPool& 
+globalPool() {
+  static ThreadPool pool(std::getenv("ROOK_THREADS") 
+                         ? (size_t)std::atoi(std::getenv("ROOK_THREADS"))
+                         : (size_t)std::thread::hardware_concurrency());
+  return pool;
+}
+
+// Kernels with less work than this (in multiply-adds, or elements for 
+// element-wise operations) stay on the calling thread.  The default is 
+// about one 784x350 matrix-vector product.
+inline size_t&
+parallelThreshold() {
+  static size_t threshold = 1 << 18;
+  return threshold;
+}
+
+// Run f(begin, end) over [0, n), split into chunks that are whole multiples
+// of grain, across the shared pool - if work is at least parallelThreshold()
+template <typename F>
+void 
+parallelFor(size_t n, size_t grain, size_t work, F f) {
+  if (work < parallelThreshold() || n <= grain || globalPool().size() == 1) {
+    f(0, n);
+    return;
+  }
+
+  // A few chunks per thread, so stealing has something to balance
+  const size_t chunks = std::min((n + grain - 1)/grain, 4*globalPool().size());
+  const size_t size   = ((n + chunks - 1)/chunks + grain - 1)/grain*grain;
+  globalPool().parallel((n + size - 1)/size, [&](size_t c) {
+    f(c*size, std::min(n, (c + 1)*size));
+  });
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
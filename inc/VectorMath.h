@@ -0,0 +1,381 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_VECTORMATH_H
+#define INCLUDED_VECTORMATH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifndef INCLUDED_SIMD_H
+#include "Simd.h"
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+
+namespace rook {
+namespace math {
+
+//------------------------------------------------------------------------------
+// Precision of the transcendental kernels.  Bounded keeps exp within a 
+// couple of ulps of expf, Fast trades that for a shorter polynomial (relative
+// error around 1e-4, plenty for a sigmoid).  Build with ROOK_FAST_MATH to make 
+// Fast the default.
+struct Bounded {};
+struct Fast    {};
+
+#ifdef ROOK_FAST_MATH
+typedef Fast    DefaultPrecision;
+#else
+typedef Bounded DefaultPrecision;
+#endif
+
+//------------------------------------------------------------------------------
+// Thin wrappers over each instruction set, so every kernel below is written 
+// once.  F is a vector of floats, I a vector of 32-bit ints, and masks are 
+// carried as F.
+#ifdef ROOK_AVX2
+struct Avx2 {
+  typedef __m256  F;
+  typedef __m256i I;
+  static const size_t width = 8;
+
+  static F    load (const float* p)   { return _mm256_loadu_ps(p); }
+  static void store(float* p, F a)    { _mm256_storeu_ps(p, a); }
+  static F    set  (float a)          { return _mm256_set1_ps(a); }
+
+  static F add(F a, F b)              { return _mm256_add_ps(a, b); }
+  static F sub(F a, F b)              { return _mm256_sub_ps(a, b); }
+  static F mul(F a, F b)              { return _mm256_mul_ps(a, b); }
+  static F div(F a, F b)              { return _mm256_div_ps(a, b); }
+  static F fma(F a, F b, F c)         { return _mm256_fmadd_ps(a, b, c); }
+  static F min(F a, F b)              { return _mm256_min_ps(a, b); }
+  static F max(F a, F b)              { return _mm256_max_ps(a, b); }
+  static F sqrt(F a)                  { return _mm256_sqrt_ps(a); }
+
+  static F less   (F a, F b)          { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static F greater(F a, F b)          { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static F select (F m, F a, F b)     { return _mm256_blendv_ps(b, a, m); }
+  static F andf   (F a, F b)          { return _mm256_and_ps(a, b); }
+  static F andnot (F a, F b)          { return _mm256_andnot_ps(a, b); }
+  static F xorf   (F a, F b)          { return _mm256_xor_ps(a, b); }
+
+  static I round   (F a)              { return _mm256_cvtps_epi32(a); }
+  static I truncate(F a)              { return _mm256_cvttps_epi32(a); }
+  static F convert (I a)              { return _mm256_cvtepi32_ps(a); }
+  static F asFloat (I a)              { return _mm256_castsi256_ps(a); }
+  static I asInt   (F a)              { return _mm256_castps_si256(a); }
+  static I iset    (int a)            { return _mm256_set1_epi32(a); }
+  static I iramp   ()                 { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+  static I iadd    (I a, I b)         { return _mm256_add_epi32(a, b); }
+  static I isub    (I a, I b)         { return _mm256_sub_epi32(a, b); }
+  static I imul    (I a, I b)         { return _mm256_mullo_epi32(a, b); }
+  static I iand    (I a, I b)         { return _mm256_and_si256(a, b); }
+  static I ior     (I a, I b)         { return _mm256_or_si256(a, b); }
+  static I ixor    (I a, I b)         { return _mm256_xor_si256(a, b); }
+  static F ieq     (I a, I b)         { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+  template <int C>
+  static I ishl    (I a)              { return _mm256_slli_epi32(a, C); }
+  template <int C>
+  static I ishr    (I a)              { return _mm256_srli_epi32(a, C); }
+};
+#endif
+
+#ifdef __SSE2__
+struct Sse2 {
+  typedef __m128  F;
+  typedef __m128i I;
+  static const size_t width = 4;
+
+  static F    load (const float* p)   { return _mm_loadu_ps(p); }
+  static void store(float* p, F a)    { _mm_storeu_ps(p, a); }
+  static F    set  (float a)          { return _mm_set1_ps(a); }
+
+  static F add(F a, F b)              { return _mm_add_ps(a, b); }
+  static F sub(F a, F b)              { return _mm_sub_ps(a, b); }
+  static F mul(F a, F b)              { return _mm_mul_ps(a, b); }
+  static F div(F a, F b)              { return _mm_div_ps(a, b); }
+  static F fma(F a, F b, F c)         { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static F min(F a, F b)              { return _mm_min_ps(a, b); }
+  static F max(F a, F b)              { return _mm_max_ps(a, b); }
+  static F sqrt(F a)                  { return _mm_sqrt_ps(a); }
+
+  static F less   (F a, F b)          { return _mm_cmplt_ps(a, b); }
+  static F greater(F a, F b)          { return _mm_cmpgt_ps(a, b); }
+  static F select (F m, F a, F b)     { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+  static F andf   (F a, F b)          { return _mm_and_ps(a, b); }
+  static F andnot (F a, F b)          { return _mm_andnot_ps(a, b); }
+  static F xorf   (F a, F b)          { return _mm_xor_ps(a, b); }
+
+  static I round   (F a)              { return _mm_cvtps_epi32(a); }
+  static I truncate(F a)              { return _mm_cvttps_epi32(a); }
+  static F convert (I a)              { return _mm_cvtepi32_ps(a); }
+  static F asFloat (I a)              { return _mm_castsi128_ps(a); }
+  static I asInt   (F a)              { return _mm_castps_si128(a); }
+  static I iset    (int a)            { return _mm_set1_epi32(a); }
+  static I iramp   ()                 { return _mm_setr_epi32(0, 1, 2, 3); }
+  static I iadd    (I a, I b)         { return _mm_add_epi32(a, b); }
+  static I isub    (I a, I b)         { return _mm_sub_epi32(a, b); }
+  static I iand    (I a, I b)         { return _mm_and_si128(a, b); }
+  static I ior     (I a, I b)         { return _mm_or_si128(a, b); }
+  static I ixor    (I a, I b)         { return _mm_xor_si128(a, b); }
+  static F ieq     (I a, I b)         { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+  template <int C>
+  static I ishl    (I a)              { return _mm_slli_epi32(a, C); }
+  template <int C>
+  static I ishr    (I a)              { return _mm_srli_epi32(a, C); }
+
+  // SSE2 has no 32-bit low multiply: take the even and odd lanes' 64-bit
+  // products and put their low halves back together
+  static I imul    (I a, I b) {
+    const I even = _mm_mul_epu32(a, b);
+    const I odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+  }
+};
+#endif
+
+// One lane at a time, for everything else
+struct Scalar {
+  typedef float   F;
+  typedef int32_t I;
+  static const size_t width = 1;
+
+  static F    load (const float* p)   { return *p; }
+  static void store(float* p, F a)    { *p = a; }
+  static F    set  (float a)          { return a; }
+
+  static F add(F a, F b)              { return a + b; }
+  static F sub(F a, F b)              { return a - b; }
+  static F mul(F a, F b)              { return a * b; }
+  static F div(F a, F b)              { return a / b; }
+  static F fma(F a, F b, F c)         { return a * b + c; }
+  static F min(F a, F b)              { return std::min(a, b); }
+  static F max(F a, F b)              { return std::max(a, b); }
+  static F sqrt(F a)                  { return std::sqrt(a); }
+
+  static F less   (F a, F b)          { return mask(a < b); }
+  static F greater(F a, F b)          { return mask(a > b); }
+  static F select (F m, F a, F b)     { return bits(m) ? a : b; }
+  static F andf   (F a, F b)          { return asFloat(bits(a) & bits(b)); }
+  static F andnot (F a, F b)          { return asFloat(~bits(a) & bits(b)); }
+  static F xorf   (F a, F b)          { return asFloat(bits(a) ^ bits(b)); }
+
+  static I round   (F a)              { return (I)std::lrint(a); }
+  static I truncate(F a)              { return (I)a; }
+  static F convert (I a)              { return (F)a; }
+  static F asFloat (I a)              { F f; std::memcpy(&f, &a, sizeof(f)); return f; }
+  static I asInt   (F a)              { return bits(a); }
+  static I iset    (int a)            { return a; }
+  static I iramp   ()                 { return 0; }
+  static I iadd    (I a, I b)         { return (I)((uint32_t)a + (uint32_t)b); }
+  static I isub    (I a, I b)         { return (I)((uint32_t)a - (uint32_t)b); }
+  static I imul    (I a, I b)         { return (I)((uint32_t)a * (uint32_t)b); }
+  static I iand    (I a, I b)         { return a & b; }
+  static I ior     (I a, I b)         { return a | b; }
+  static I ixor    (I a, I b)         { return a ^ b; }
+  static F ieq     (I a, I b)         { return mask(a == b); }
+  template <int C>
+  static I ishl    (I a)              { return (I)((uint32_t)a << C); }
+  template <int C>
+  static I ishr    (I a)              { return (I)((uint32_t)a >> C); }
+
+private:
+  static I bits(F a)                  { I i; std::memcpy(&i, &a, sizeof(i)); return i; }
+  static F mask(bool b)               { return asFloat(b ? -1 : 0); }
+};
+
+// The widest instruction set we were built for
+#if defined(ROOK_AVX2)
+typedef Avx2   Native;
+#elif defined(__SSE2__)
+typedef Sse2   Native;
+#else
+typedef Scalar Native;
+#endif
+
+//------------------------------------------------------------------------------
+// |a|
+template <typename V>
+typename V::F
+abs(typename V::F a) {
+  return V::andnot(V::set(-0.0f), a);
+}
+
+// e^x after Cephes: x = n*ln2 + r with |r| <= ln2/2, e^x = 2^n * p(r).
+// Inputs are clamped to keep 2^n a normal float.
+template <typename V>
+typename V::F
+exp2n(typename V::F& x) {
+  x = V::min(V::max(x, V::set(-87.3f)), V::set(88.0f));
+  const typename V::I n = V::round(V::mul(x, V::set(1.44269504088896341f)));
+  const typename V::F f = V::convert(n);
+  x = V::fma(f, V::set(-0.693359375f), x);
+  x = V::fma(f, V::set(2.12194440e-4f), x);
+  return V::asFloat(V::template ishl<23>(V::iadd(n, V::iset(127))));
+}
+
+template <typename V>
+typename V::F
+exp(typename V::F x, Bounded) {
+  const typename V::F scale = exp2n<V>(x);
+  typename V::F p = V::set(1.9875691500e-4f);
+  p = V::fma(p, x, V::set(1.3981999507e-3f));
+  p = V::fma(p, x, V::set(8.3334519073e-3f));
+  p = V::fma(p, x, V::set(4.1665795894e-2f));
+  p = V::fma(p, x, V::set(1.6666665459e-1f));
+  p = V::fma(p, x, V::set(5.0000001201e-1f));
+  p = V::fma(p, V::mul(x, x), V::add(x, V::set(1.0f)));
+  return V::mul(p, scale);
+}
+
+template <typename V>
+typename V::F
+exp(typename V::F x, Fast) {
+  const typename V::F scale = exp2n<V>(x);
+  typename V::F p = V::set(1.668e-1f);
+  p = V::fma(p, x, V::set(5.04e-1f));
+  p = V::fma(p, V::mul(x, x), V::add(x, V::set(1.0f)));
+  return V::mul(p, scale);
+}
+
+// Natural log after Cephes logf: x = m * 2^e with m in [sqrt(1/2), sqrt(2)),
+// log(x) = e*ln2 + p(m - 1).  For x > 0; tiny and denormal inputs are 
+// clamped to the smallest normal float.
+template <typename V>
+typename V::F
+log(typename V::F x) {
+  typedef typename V::F F;
+  typedef typename V::I I;
+
+  x = V::max(x, V::set(1.17549435e-38f));
+  const I bits = V::asInt(x);
+  F e = V::convert(V::isub(V::template ishr<23>(bits), V::iset(126)));
+  F m = V::asFloat(V::ior(V::iand(bits, V::iset(0x007fffff)), V::iset(0x3f000000)));
+
+  // m in [0.5, 1): below sqrt(1/2) take 2m - 1 and one less from e
+  const F small = V::less(m, V::set(0.707106781186547524f));
+  e = V::sub(e, V::andf(small, V::set(1.0f)));
+  m = V::sub(V::add(m, V::andf(small, m)), V::set(1.0f));
+
+  const F z = V::mul(m, m);
+  F p = V::set(7.0376836292e-2f);
+  p = V::fma(p, m, V::set(-1.1514610310e-1f));
+  p = V::fma(p, m, V::set(1.1676998740e-1f));
+  p = V::fma(p, m, V::set(-1.2420140846e-1f));
+  p = V::fma(p, m, V::set(1.4249322787e-1f));
+  p = V::fma(p, m, V::set(-1.6668057665e-1f));
+  p = V::fma(p, m, V::set(2.0000714765e-1f));
+  p = V::fma(p, m, V::set(-2.4999993993e-1f));
+  p = V::fma(p, m, V::set(3.3333331174e-1f));
+  p = V::mul(V::mul(p, m), z);
+
+  p = V::fma(e, V::set(-2.12194440e-4f), p);
+  p = V::fma(z, V::set(-0.5f), p);
+  return V::fma(e, V::set(0.693359375f), V::add(m, p));
+}
+
+// sin(x) and cos(x) together, after Cephes sinf/cosf (accurate for 
+// |x| < 8192): reduce by pi/4 and pick a polynomial by octant
+template <typename V>
+void
+sincos(typename V::F x, typename V::F& s, typename V::F& c) {
+  typedef typename V::F F;
+  typedef typename V::I I;
+
+  const F sign = V::andf(x, V::set(-0.0f));
+  x = abs<V>(x);
+
+  // j = (int(x * 4/pi) + 1) & ~1
+  I j = V::truncate(V::mul(x, V::set(1.27323954473516f)));
+  j = V::iand(V::iadd(j, V::iset(1)), V::iset(~1));
+  const F y = V::convert(j);
+
+  x = V::fma(y, V::set(-0.78515625f),              x);
+  x = V::fma(y, V::set(-2.4187564849853515625e-4f), x);
+  x = V::fma(y, V::set(-3.77489497744594108e-8f),   x);
+
+  const F z = V::mul(x, x);
+  F pc = V::set(2.443315711809948e-5f);
+  pc = V::fma(pc, z, V::set(-1.388731625493765e-3f));
+  pc = V::fma(pc, z, V::set(4.166664568298827e-2f));
+  pc = V::fma(V::mul(pc, z), z, V::fma(z, V::set(-0.5f), V::set(1.0f)));
+
+  F ps = V::set(-1.9515295891e-4f);
+  ps = V::fma(ps, z, V::set(8.3321608736e-3f));
+  ps = V::fma(ps, z, V::set(-1.6666654611e-1f));
+  ps = V::fma(V::mul(ps, z), x, x);
+
+  // Octants 2, 3, 6 and 7 swap the polynomials
+  const F swap = V::ieq(V::iand(j, V::iset(2)), V::iset(2));
+  s = V::select(swap, pc, ps);
+  c = V::select(swap, ps, pc);
+
+  // Fix up the signs
+  const F negS = V::asFloat(V::template ishl<29>(V::iand(j, V::iset(4))));
+  const F negC = V::asFloat(V::template ishl<29>(V::iand(V::iadd(j, V::iset(2)), V::iset(4))));
+  s = V::xorf(s, V::xorf(sign, negS));
+  c = V::xorf(c, negC);
+}
+
+//------------------------------------------------------------------------------
+// out[i] = Op(in[i]) for i < n.  Op provides 
+//   template <typename V> static typename V::F apply(typename V::F);
+// and the tail is padded out to a whole vector, so every element goes 
+// through exactly the same arithmetic.  in and out may be the same.
+template <typename Op>
+void
+map(const float* in, float* out, size_t n) {
+  typedef Native V;
+  const size_t w = V::width;
+  size_t i = 0;
+  for (; i + w <= n; i += w) {
+    V::store(out + i, Op::template apply<V>(V::load(in + i)));
+  }
+  if (i < n) {
+    float tail[V::width] = {0.0f};
+    std::copy(in + i, in + n, tail);
+    V::store(tail, Op::template apply<V>(V::load(tail)));
+    std::copy(tail, tail + (n - i), out + i);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace math
+} // namespace rook
+
+//------------------------------------------------------------------------------
+
+#endif
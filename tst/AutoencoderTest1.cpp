@@ -25,6 +25,8 @@
 */
 
 #include "Autoencoder.h"
+#include "MnistData.h"
+#include "Encoding.h"
 
 #ifdef GRAPHICS
 #include <Magick++.h>
@@ -50,13 +52,6 @@
  *
  */
 
-// Some byte swapping (MNIST data is big endian)
-#define SWAP_UINT16(x) (((x) >> 8) | ((x) << 8))
-#define SWAP_UINT32(x) (((x) >> 24) \
-                     | (((x) & 0x00FF0000) >> 8) \
-                     | (((x) & 0x0000FF00) << 8) \
-                     |  ((x) << 24))
-
 //------------------------------------------------------------------------------
 // For some primitive performance analysis
 template <typename Resolution = std::chrono::nanoseconds>
@@ -71,59 +66,8 @@ struct Stopwatch {
 };
 
 //------------------------------------------------------------------------------
-// Helper class for loading data from the MNIST files
-struct MnistData {
-  typedef std::vector<uint8_t> Image;
-  typedef uint8_t              Label;
-
-  MnistData(const std::string& imageFile, const std::string& labelFile) {
-    std::ifstream images, labels;
-    images.open(imageFile, std::ios::binary);
-    labels.open(labelFile, std::ios::binary);
-
-    uint32_t magic, numLabels;
-    images.read(reinterpret_cast<char*>(&magic),      sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numImages_), sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numRows_),   sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numCols_),   sizeof(uint32_t));
-
-    labels.read(reinterpret_cast<char*>(&magic),      sizeof(uint32_t));
-    labels.read(reinterpret_cast<char*>(&numLabels),  sizeof(uint32_t));
-
-    numImages_ = SWAP_UINT32(numImages_);
-    numLabels  = SWAP_UINT32(numLabels);
-    numRows_   = SWAP_UINT32(numRows_);
-    numCols_   = SWAP_UINT32(numCols_);
-
-    uint8_t             pixel, label;
-    Image               image(numRows_ * numCols_);
-    imageData_.resize(numImages_);
-    for (int c = 0; c < numImages_; c++) { 
-      for (int y = 0; y < numRows_; y++) { 
-        for (int x = 0; x < numCols_; x++) { 
-          images.read(reinterpret_cast<char*>(&pixel), sizeof(uint8_t));
-          image[(y*numCols_ + x)] = pixel; 
-        }
-      }
-
-      labels.read(reinterpret_cast<char*>(&label), sizeof(uint8_t));
-      imageData_[c] = std::make_tuple(image,label);
-    }
-  }
-  
-  // Do something for each image and label
-  void each(std::function<void (const Image&, const Label&)> f) { 
-    for (auto image : imageData_) {
-      f(std::get<0>(image), std::get<1>(image));
-    }
-  }
-  
-  uint32_t                                numRows_;
-  uint32_t                                numCols_;
-  uint32_t                                numImages_;
-private:
-  std::vector<std::tuple<Image, Label>>   imageData_;
-};
+// MNIST images and labels (see MnistData.h)
+using rook::MnistData;
 
 //------------------------------------------------------------------------------
 
@@ -133,24 +77,24 @@ typedef rook::Autoencoder<784, 300> Encoder;
 // Note that dimensions must be the same - this is 
 // big mismatch between compile-time and run-time 
 // parameterization
+const rook::Encoding pixelEncoding = rook::Encoding::unit(28*28);
+
 Encoder::Input encodeImage(const MnistData::Image& image) {
   Encoder::Input input;
-  for (int x = 0; x < image.size(); x++) { 
-    input.at(x) = image[x]/255.0f; 
-  }
+  rook::encodeSample(image.data(), image.size(), pixelEncoding, input.raw().data());
   return input;
 }
 
-MnistData::Image decodeImage(const Encoder::Input& input) {
-  MnistData::Image image;
+std::vector<uint8_t> decodeImage(const Encoder::Input& input) {
+  std::vector<uint8_t> image;
   for (int x = 0; x < input.raw().size(); x++) { 
     image.push_back((uint8_t)floor(input.raw()[x] * 255.0f));
   }
   return image;
 }
 
-MnistData::Image decodeFilter(const Encoder::Input& input) {
-  MnistData::Image image;
+std::vector<uint8_t> decodeFilter(const Encoder::Input& input) {
+  std::vector<uint8_t> image;
   for (int x = 0; x < input.raw().size(); x++) { 
     image.push_back((uint8_t)floor(((input.raw()[x] + 1.0f)/2.0f) * 255.0f));
   }
@@ -199,7 +143,7 @@ int main (int argc, char ** argv) {
   testData.each([&](const MnistData::Image& image, const MnistData::Label& label) {
     const auto digit           = encodeImage(image);
     const auto reconstruction  = encoder.reconstruct(digit);
-    std::cout << "Error: " << mag(digit - reconstruction) << std::endl;
+    std::cout << "Error: " << mag(Encoder::Input(digit - reconstruction)) << std::endl;
   
     #ifdef GRAPHICS
     // Sample our reconstructions
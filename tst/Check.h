@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#ifndef INCLUDED_CHECK_H
+#define INCLUDED_CHECK_H
+
+#ifndef INCLUDED_MATRIX_H
+#include "Matrix.h"
+#endif
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Shared by the runtime tests.  Every check prints pass or FAIL, and main()
+// returns non-zero if any of them failed.
+static int failures = 0;
+
+void check(const std::string& name, bool ok) {
+  std::cout << (ok ? "pass: " : "FAIL: ") << name << std::endl;
+  if (!ok) failures++;
+}
+
+// Relative error within tolerance, or absolute error for values below one
+bool close(float a, float b, float tolerance = 1.0e-4f) {
+  return std::fabs(a - b) <= tolerance * std::max(1.0f, std::fabs(b));
+}
+
+template <size_t M, size_t N, typename S, typename T>
+bool close(const rook::Matrix<M, N, float, S>& a, const rook::Matrix<M, N, float, T>& b, 
+           float tolerance = 1.0e-4f) {
+  for (size_t i = 0; i < M; i++) {
+    for (size_t j = 0; j < N; j++) {
+      if (!close(a.at(i, j), b.at(i, j), tolerance)) return false;
+    }
+  }
+  return true;
+}
+
+// A path for a scratch file, unique to this process
+std::string scratchPath(const std::string& name) {
+  return std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp") + 
+         "/rook-" + std::to_string(getpid()) + "-" + name;
+}
+
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "Checkpoint.h"
+#include "Check.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for checkpoints: networks come back exactly as they were
+ * saved, big weight matrices are used in place in the mapping, and files 
+ * that don't match the network are rejected with std::runtime_error.
+ *
+ */
+
+float uniform(size_t i, size_t j) {
+  return (float)(rand()%1001)/1000.0f;
+}
+
+template <typename F>
+bool rejects(F f) {
+  try {
+    f();
+  } catch (std::runtime_error& e) {
+    std::cout << "      " << e.what() << std::endl;
+    return true;
+  }
+  return false;
+}
+
+// Big enough that the first layer's weights live on the heap
+typedef rook::Layer<40, 300>               InputLayer;
+typedef rook::Layer<300, 5, rook::Linear>  OutputLayer;
+typedef rook::FeedForwardNetwork<InputLayer, OutputLayer> Network;
+
+//------------------------------------------------------------------------------
+
+int main() {
+  const std::string path = scratchPath("network.ckpt");
+  Network saved;
+  rook::save(path, saved);
+
+  // The same network comes back, with its heap weights in the mapping
+  const InputLayer::Input x(uniform);
+  {
+    Network restored;
+    rook::Checkpoint checkpoint(path);
+    checkpoint.restore(restored);
+
+    const uint8_t* weights = (const uint8_t*)restored.getLayer().getWeightMatrix().raw().data();
+    check("restore network", restored.infer(x) == saved.infer(x));
+    check("restore in place", weights >= checkpoint.data() && weights < checkpoint.data() + checkpoint.size() &&
+                              (uintptr_t)weights % rook::Alignment == 0);
+    check("restore layout", checkpoint.layers() == 2 && checkpoint.layer(0).inputs == 40 && 
+                            checkpoint.layer(1).activation == (uint32_t)rook::ActivationType::Linear);
+
+    // Learning after a restore leaves the file alone
+    const OutputLayer::Output target(uniform);
+    restored.learn(x, target);
+    rook::Checkpoint again(path);
+    Network unchanged;
+    again.restore(unchanged);
+    check("restore is private", unchanged.infer(x) == saved.infer(x) && restored.infer(x) != saved.infer(x));
+  }
+
+  // Single layers and autoencoders
+  {
+    const std::string layerPath = scratchPath("layer.ckpt");
+    InputLayer layer, restored;
+    rook::save(layerPath, layer);
+    rook::Checkpoint checkpoint(layerPath);
+    checkpoint.restore(restored);
+    check("restore layer", restored.infer(x) == layer.infer(x));
+    std::remove(layerPath.c_str());
+
+    const std::string autoencoderPath = scratchPath("autoencoder.ckpt");
+    rook::Autoencoder<40, 300> autoencoder, restoredAutoencoder;
+    rook::save(autoencoderPath, autoencoder);
+    rook::Checkpoint autoencoderCheckpoint(autoencoderPath);
+    autoencoderCheckpoint.restore(restoredAutoencoder);
+    check("restore autoencoder", restoredAutoencoder.encode(x) == autoencoder.encode(x) &&
+                                 restoredAutoencoder.decode(autoencoder.encode(x)) == autoencoder.decode(autoencoder.encode(x)));
+    std::remove(autoencoderPath.c_str());
+  }
+
+  // Mismatched networks and damaged files
+  {
+    check("reject shape", rejects([&] {
+      rook::FeedForwardNetwork<rook::Layer<40, 300>, rook::Layer<300, 6, rook::Linear>> other;
+      rook::Checkpoint(path).restore(other);
+    }));
+    check("reject activation", rejects([&] {
+      rook::FeedForwardNetwork<rook::Layer<40, 300>, rook::Layer<300, 5>> other;
+      rook::Checkpoint(path).restore(other);
+    }));
+    check("reject depth", rejects([&] {
+      InputLayer other;
+      rook::Checkpoint(path).restore(other);
+    }));
+
+    const std::string bad = scratchPath("bad.ckpt");
+    {
+      std::ofstream out(bad, std::ios::binary);
+      out << "ROOKCKPX and some more bytes to fill out the header, past 64 bytes of it...";
+    }
+    check("reject magic", rejects([&] { rook::Checkpoint checkpoint(bad); }));
+    {
+      std::ifstream in(path, std::ios::binary);
+      std::vector<char> bytes(200);
+      in.read(bytes.data(), bytes.size());
+      std::ofstream out(bad, std::ios::binary);
+      out.write(bytes.data(), bytes.size());
+    }
+    check("reject truncated", rejects([&] { rook::Checkpoint checkpoint(bad); }));
+    {
+      // An aligned offset so large that offset + size wraps around
+      std::ifstream in(path, std::ios::binary);
+      std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      const uint64_t wrapped = (uint64_t)0 - rook::Alignment;
+      std::memcpy(&bytes[sizeof(rook::CheckpointHeader) + offsetof(rook::CheckpointLayer, weights)], 
+                  &wrapped, sizeof(wrapped));
+      std::ofstream out(bad, std::ios::binary);
+      out.write(bytes.data(), bytes.size());
+    }
+    check("reject out-of-bounds offset", rejects([&] { rook::Checkpoint checkpoint(bad); }));
+    check("reject missing", rejects([&] { rook::Checkpoint checkpoint(scratchPath("missing.ckpt")); }));
+    std::remove(bad.c_str());
+  }
+
+  std::remove(path.c_str());
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "DynamicNetwork.h"
+#include "FeedForwardNetwork.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the run-time shaped DynamicMatrix, DynamicLayer and
+ * DynamicNetwork.  Each is compared against its fixed-size counterpart,
+ * given the same weights.
+ *
+ */
+
+template <size_t M, size_t N>
+bool close(const rook::DynamicMatrix<float>& a, const rook::Matrix<M, N>& b) {
+  if (a.rows() != M || a.cols() != N) return false;
+  for (size_t i = 0; i < M; i++) {
+    for (size_t j = 0; j < N; j++) {
+      if (!close(a.at(i, j), b.at(i, j))) return false;
+    }
+  }
+  return true;
+}
+
+float uniform(size_t i, size_t j) {
+  return (float)(rand()%2001 - 1000)/1000.0f;
+}
+
+typedef rook::DynamicMatrix<float>      Dynamic;
+typedef rook::Layer<60, 20>             InputLayer;
+typedef rook::Layer<20,  5>             OutputLayer;
+typedef rook::FeedForwardNetwork<InputLayer, OutputLayer> Network;
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // The same kernels as the fixed-size products
+  {
+    static rook::Matrix<130, 520> a(uniform);
+    static rook::Matrix<520, 200> b(uniform);
+    const rook::ColVector<520>    x(uniform);
+    const Dynamic da(a), db(b), dx(x);
+    check("DynamicMatrix multiply", close(da * db, a * b));
+    check("DynamicMatrix gemv",     close(gemv(da, dx), gemv(a, x)));
+    check("DynamicMatrix gemv_t",   close(gemv_t(db, dx), gemv_t(b, x)));
+    check("DynamicMatrix element-wise", close(da % da - da + da, rook::Matrix<130, 520>(a % a)));
+  }
+
+  // Shapes are checked at run time instead
+  {
+    bool thrown = false;
+    try {
+      Dynamic(3, 4) * Dynamic(3, 4);
+    } catch (const std::invalid_argument&) {
+      thrown = true;
+    }
+    check("DynamicMatrix shape mismatch", thrown);
+
+    size_t refused = 0;
+    rook::DynamicNetwork empty;
+    try { empty.infer(Dynamic(3, 1)); } catch (const std::invalid_argument&) { refused++; }
+    try { empty.learn(Dynamic(3, 1), Dynamic(3, 1)); } catch (const std::invalid_argument&) { refused++; }
+    check("DynamicNetwork without layers", refused == 2);
+
+    size_t zeros = 0;
+    try { rook::DynamicLayer(0, 3); } catch (const std::invalid_argument&) { zeros++; }
+    try { rook::DynamicLayer(3, 0); } catch (const std::invalid_argument&) { zeros++; }
+    try { rook::DynamicNetwork::parse("784 0 10"); } catch (const std::invalid_argument&) { zeros++; }
+    try { rook::DynamicNetwork::parse("0 10"); } catch (const std::invalid_argument&) { zeros++; }
+    check("zero-sized layers", zeros == 4);
+  }
+
+  // A DynamicLayer infers and learns just as a Layer does
+  {
+    InputLayer   layer;
+    rook::DynamicLayer dynamic(Dynamic(layer.getWeightMatrix()), Dynamic(layer.getBias()));
+
+    const InputLayer::Input  x(uniform);
+    const InputLayer::Output t(uniform);
+    check("DynamicLayer::infer", close(dynamic.infer(Dynamic(x)), layer.infer(x)));
+
+    const auto e1 = layer.learn(x, layer.infer(x), t);
+    const auto e2 = dynamic.learn(Dynamic(x), dynamic.infer(Dynamic(x)), Dynamic(t));
+    check("DynamicLayer::learn", close(dynamic.getWeightMatrix(), layer.getWeightMatrix()) &&
+                                 close(std::get<0>(e2), std::get<0>(e1)));
+
+    const InputLayer::InputBatch<8>  xb(uniform);
+    const InputLayer::OutputBatch<8> tb(uniform);
+    layer.learnBatch(xb, layer.inferBatch(xb), tb);
+    dynamic.learn(Dynamic(xb), dynamic.infer(Dynamic(xb)), Dynamic(tb));
+    check("DynamicLayer::learn batch", close(dynamic.getWeightMatrix(), layer.getWeightMatrix()));
+  }
+
+  // A network composed at run time matches a FeedForwardNetwork
+  {
+    Network network;
+    rook::DynamicNetwork dynamic = rook::DynamicNetwork::parse("60 20:sigmoid 5");
+    dynamic.getLayer(0).getWeightMatrix() = Dynamic(network.getLayer().getWeightMatrix());
+    dynamic.getLayer(0).getBias()         = Dynamic(network.getLayer().getBias());
+    dynamic.getLayer(1).getWeightMatrix() = Dynamic(network.getRemainNetwork().getLayer().getWeightMatrix());
+    dynamic.getLayer(1).getBias()         = Dynamic(network.getRemainNetwork().getLayer().getBias());
+
+    const Network::Input  x(uniform);
+    const Network::Output t(uniform);
+    check("DynamicNetwork::infer", close(dynamic.infer(Dynamic(x)), network.infer(x)));
+
+    network.learn(x, t);
+    dynamic.learn(Dynamic(x), Dynamic(t));
+    check("DynamicNetwork::learn", 
+          close(dynamic.getLayer(0).getWeightMatrix(), network.getLayer().getWeightMatrix()) &&
+          close(dynamic.getLayer(1).getWeightMatrix(), network.getRemainNetwork().getLayer().getWeightMatrix()));
+  }
+
+  // Shapes bigger than any stack, without a recompile
+  {
+    rook::DynamicNetwork wide({2000, 3000, 10});
+    const Dynamic x(2000, 1, uniform);
+    check("DynamicNetwork 2000x3000x10", wide.infer(x).rows() == 10);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,203 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "Encoding.h"
+#include "Prefetcher.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the input pipeline.  The vectorized batch transposes
+ * are compared against a plain loop, on shapes with sample and feature 
+ * tails, and prefetched batches must arrive whole and in order.
+ *
+ */
+
+// The batch encoders do the same arithmetic as the reference, so agree
+// more tightly than Check.h's default
+const float exact = 1.0e-5f;
+
+std::vector<uint8_t> bytes(size_t n) {
+  std::vector<uint8_t> result(n);
+  for (auto& b : result) b = rand()%256;
+  return result;
+}
+
+// Feature p of sample b, encoded the slow way
+float reference(const std::vector<uint8_t>& samples, size_t features, 
+                const rook::Encoding& e, size_t b, size_t p) {
+  return samples[b*features + p]*e.scale[p] + e.offset[p];
+}
+
+template <size_t X, size_t B>
+bool matches(const rook::Matrix<X, B>& batch, const std::vector<uint8_t>& samples,
+             const rook::Encoding& e, const size_t* indices) {
+  for (size_t p = 0; p < X; p++) {
+    for (size_t b = 0; b < B; b++) {
+      if (!close(batch.at(p, b), reference(samples, X, e, indices[b], p), exact)) return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  size_t identity[128];
+  for (size_t i = 0; i < 128; i++) identity[i] = i;
+
+  // Unit encoding, single samples and whole batches with both tails
+  {
+    const auto samples = bytes(64*29);
+    const auto e = rook::Encoding::unit(29);
+
+    rook::ColVector<29> x;
+    rook::encodeSample(&samples[29*5], 29, e, x.raw().data());
+    bool ok = true;
+    for (size_t p = 0; p < 29; p++) {
+      ok = ok && close(x.at(p), samples[29*5 + p]/255.0f, exact);
+    }
+    check("encode sample", ok);
+
+    rook::Matrix<29, 13> batch;
+    rook::encodeBatch(samples.data(), 29, e, batch);
+    check("encode batch 29x13", matches(batch, samples, e, identity));
+
+    rook::Matrix<29, 64> wide;
+    rook::encodeBatch(samples.data(), 29, e, wide);
+    check("encode batch 29x64", matches(wide, samples, e, identity));
+  }
+
+  // Standardized features have zero mean and unit deviation, except those
+  // that never vary
+  {
+    const size_t count = 500, features = 20;
+    auto samples = bytes(count*features);
+    for (size_t s = 0; s < count; s++) samples[s*features] = 7;
+
+    const auto e = rook::Encoding::standardize(samples.data(), count, features);
+    bool ok = true;
+    for (size_t p = 0; p < features; p++) {
+      double sum = 0.0, squares = 0.0;
+      for (size_t s = 0; s < count; s++) {
+        const double y = reference(samples, features, e, s, p);
+        sum += y;
+        squares += y*y;
+      }
+      ok = ok && std::fabs(sum/count) < 1.0e-3;
+      ok = ok && (p == 0 ? squares < 1.0e-6 : std::fabs(squares/count - 1.0) < 1.0e-3);
+    }
+    check("standardize per feature", ok);
+
+    const auto g = rook::Encoding::standardize(samples.data(), count, features, false);
+    check("standardize globally", g.scale[0] == g.scale[19] && g.offset[0] == g.offset[19]);
+
+    bool thrown = false;
+    try {
+      rook::Encoding::standardize(samples.data(), 0, features);
+    } catch (const std::invalid_argument&) {
+      thrown = true;
+    }
+    check("standardize no samples", thrown);
+
+    rook::Matrix<20, 16> batch;
+    rook::encodeBatch(samples.data(), features, e, batch);
+    check("encode standardized batch", matches(batch, samples, e, identity));
+  }
+
+  // The float arena holds every sample encoded, and gathers batches in any 
+  // order
+  {
+    const auto samples = bytes(100*37);
+    const auto e = rook::Encoding::unit(37);
+    const rook::FloatArena arena(samples.data(), 100, 37, e);
+
+    bool ok = arena.size() == 100 && arena.features() == 37;
+    for (size_t s = 0; s < 100; s++) {
+      ok = ok && (uintptr_t)arena.sample(s) % rook::Alignment == 0;
+      for (size_t p = 0; p < 37; p++) {
+        ok = ok && close(arena.sample(s)[p], reference(samples, 37, e, s, p), exact);
+      }
+    }
+    check("arena samples", ok);
+
+    size_t indices[19];
+    for (size_t b = 0; b < 19; b++) indices[b] = (b*41)%100;
+    rook::Matrix<37, 19> batch;
+    arena.gather(indices, batch);
+    check("arena gather", matches(batch, samples, e, indices));
+
+    // Mismatched sizes are refused
+    size_t refused = 0;
+    rook::Matrix<36, 19> narrow;
+    try { arena.gather(indices, narrow); } catch (const std::invalid_argument&) { refused++; }
+    try { rook::encodeBatch(samples.data(), 37, rook::Encoding::unit(36), batch); } catch (const std::invalid_argument&) { refused++; }
+    check("mismatched sizes", refused == 2);
+  }
+
+  // Prefetched batches arrive in order, whatever the number of slots, and
+  // the producer can be abandoned part way through
+  {
+    const auto samples = bytes(100*37);
+    const auto e = rook::Encoding::unit(37);
+    typedef rook::Matrix<37, 8> Batch;
+
+    for (size_t slots = 1; slots <= 3; slots++) {
+      size_t produced = 0;
+      rook::Prefetcher<Batch> prefetcher([&](Batch& batch) {
+        if (produced + 8 > 100) return false;
+        rook::encodeBatch(&samples[produced*37], 37, e, batch);
+        produced += 8;
+        return true;
+      }, slots);
+
+      size_t consumed = 0;
+      bool   ok       = true;
+      for (const Batch* batch; (batch = prefetcher.next()); consumed++) {
+        ok = ok && matches(*batch, samples, e, identity + consumed*8);
+      }
+      check("prefetch " + std::to_string(slots) + " slots", ok && consumed == 12 && !prefetcher.next());
+    }
+
+    size_t produced = 0;
+    {
+      rook::Prefetcher<Batch> prefetcher([&](Batch&) {
+        produced++;
+        return true;
+      });
+      prefetcher.next();
+    }
+    check("prefetch abandoned", produced >= 1 && produced <= 3);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
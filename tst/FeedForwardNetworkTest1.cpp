@@ -24,7 +24,16 @@
 *  SOFTWARE.
 */
 
-#include "FeedForwardNetwork.h"
+#include "ParallelTrainer.h"
+#include "HogwildTrainer.h"
+#include "Pipeline.h"
+#include "MnistData.h"
+#include "Encoding.h"
+#include "Prefetcher.h"
+#include "Sampler.h"
+#include "Checkpoint.h"
+#include "StackedAutoencoder.h"
+#include "Quantized.h"
 
 #include <iostream>
 #include <sstream>
@@ -45,13 +54,6 @@
  *
  */
 
-// Some byte swapping (MNIST data is big endian)
-#define SWAP_UINT16(x) (((x) >> 8) | ((x) << 8))
-#define SWAP_UINT32(x) (((x) >> 24) \
-                     | (((x) & 0x00FF0000) >> 8) \
-                     | (((x) & 0x0000FF00) << 8) \
-                     |  ((x) << 24))
-
 //------------------------------------------------------------------------------
 // For some primitive performance analysis
 template <typename Resolution = std::chrono::nanoseconds>
@@ -66,59 +68,8 @@ struct Stopwatch {
 };
 
 //------------------------------------------------------------------------------
-// Helper class for loading data from the MNIST files
-struct MnistData {
-  typedef std::vector<uint8_t> Image;
-  typedef uint8_t              Label;
-
-  MnistData(const std::string& imageFile, const std::string& labelFile) {
-    std::ifstream images, labels;
-    images.open(imageFile, std::ios::binary);
-    labels.open(labelFile, std::ios::binary);
-
-    uint32_t magic, numLabels;
-    images.read(reinterpret_cast<char*>(&magic),      sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numImages_), sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numRows_),   sizeof(uint32_t));
-    images.read(reinterpret_cast<char*>(&numCols_),   sizeof(uint32_t));
-
-    labels.read(reinterpret_cast<char*>(&magic),      sizeof(uint32_t));
-    labels.read(reinterpret_cast<char*>(&numLabels),  sizeof(uint32_t));
-
-    numImages_ = SWAP_UINT32(numImages_);
-    numLabels  = SWAP_UINT32(numLabels);
-    numRows_   = SWAP_UINT32(numRows_);
-    numCols_   = SWAP_UINT32(numCols_);
-
-    uint8_t             pixel, label;
-    Image               image(numRows_ * numCols_);
-    imageData_.resize(numImages_);
-    for (int c = 0; c < numImages_; c++) { 
-      for (int y = 0; y < numRows_; y++) { 
-        for (int x = 0; x < numCols_; x++) { 
-          images.read(reinterpret_cast<char*>(&pixel), sizeof(uint8_t));
-          image[(y*numCols_ + x)] = pixel; 
-        }
-      }
-
-      labels.read(reinterpret_cast<char*>(&label), sizeof(uint8_t));
-      imageData_[c] = std::make_tuple(image,label);
-    }
-  }
-  
-  // Do something for each image and label
-  void each(std::function<void (const Image&, const Label&)> f) { 
-    for (auto image : imageData_) {
-      f(std::get<0>(image), std::get<1>(image));
-    }
-  }
-  
-  uint32_t                                numRows_;
-  uint32_t                                numCols_;
-  uint32_t                                numImages_;
-private:
-  std::vector<std::tuple<Image, Label>>   imageData_;
-};
+// MNIST images and labels (see MnistData.h)
+using rook::MnistData;
 
 //------------------------------------------------------------------------------
 // Some typedefs for convenience
@@ -131,7 +82,7 @@ typedef rook::Layer<350,  10> OutputLayer;
 template <size_t N>
 float mag(const rook::Matrix<N, 1>& vec) {
   float result = 0.0f;
-  for (int i = 0; i < N; i++) {
+  for (size_t i = 0; i < N; i++) {
     result += vec.at(i) * vec.at(i);
   }
   return sqrtf(result);
@@ -141,11 +92,11 @@ float mag(const rook::Matrix<N, 1>& vec) {
 // Note that dimensions must be the same - this is 
 // big mismatch between compile-time and run-time 
 // parameterization
+const rook::Encoding pixelEncoding = rook::Encoding::unit(28*28);
+
 InputLayer::Input encodeImage(const MnistData::Image& image) {
   InputLayer::Input input;
-  for (int x = 0; x < image.size(); x++) { 
-    input.at(x) = image[x]/255.0f; 
-  }
+  rook::encodeSample(image.data(), image.size(), pixelEncoding, input.raw().data());
   return input;
 }
 
@@ -155,6 +106,15 @@ OutputLayer::Output encodeLabel(const MnistData::Label& label) {
   }); 
 }
 
+// A run of training samples, encoded on the prefetch thread
+struct Chunk {
+  static const size_t Capacity = 32;
+  InputLayer::Input   inputs[Capacity];
+  OutputLayer::Output targets[Capacity];
+  MnistData::Label    labels[Capacity];
+  size_t              size;
+};
+
 MnistData::Label decodeOutput(const OutputLayer::Output& output) {
   int guess = 0;
   for (int i = 0; i < 10; i++) {
@@ -165,6 +125,100 @@ MnistData::Label decodeOutput(const OutputLayer::Output& output) {
   return guess;
 }
 
+// Batched inference throughput: score the first B test digits at a time,
+// encoded straight into the batch
+template <size_t B, typename Network>
+void benchmarkBatch(const Network& network, const MnistData& data) {
+  typename Network::template InputBatch<B> batch;
+  rook::encodeBatch(data.image(0).data(), data.stride(), pixelEncoding, batch);
+
+  const size_t rounds = 10000/B;
+  float        total  = 0.0f;
+  auto micros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    for (size_t r = 0; r < rounds; r++) {
+      total += network.inferBatch(batch).at(0, 0);
+    }
+  });
+
+  std::cout << "Batch of " << std::setw(3) << B << ": " 
+            << (unsigned)((rounds * B * 1.0e6)/std::max<uint64_t>(micros, 1)) 
+            << " samples/s (" << total << ")" << std::endl;
+}
+
+// Streaming inference throughput, with one thread per layer
+template <typename Network>
+void benchmarkPipeline(Network& network, const typename Network::Input& digit) {
+  const size_t         samples = 10000;
+  float                total   = 0.0f;
+  rook::Pipeline<Network> pipeline(network);
+  auto micros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    std::thread producer([&] {
+      for (size_t i = 0; i < samples; i++) pipeline.push(digit);
+    });
+    for (size_t i = 0; i < samples; i++) {
+      total += pipeline.pop().at(0);
+    }
+    producer.join();
+  });
+
+  std::cout << "Pipelined:    " 
+            << (unsigned)((samples * 1.0e6)/std::max<uint64_t>(micros, 1)) 
+            << " samples/s (" << total << ")" << std::endl;
+}
+
+// Percentage of data misclassified by network
+template <typename Network>
+float testError(const Network& network, const MnistData& data) {
+  unsigned correct = 0;
+  for (size_t i = 0; i < data.size(); i++) {
+    correct += decodeOutput(network.infer(encodeImage(data.image(i)))) == data.label(i);
+  }
+  return (1.0f - (float)correct/(float)data.size()) * 100.0f;
+}
+
+// Single-sample inference throughput, for comparing the float network
+// with its quantized copy
+template <typename Network>
+void benchmarkSingle(const std::string& name, const Network& network, 
+                     const std::vector<InputLayer::Input>& digits) {
+  const size_t rounds = 10;
+  float        total  = 0.0f;
+  auto micros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    for (size_t r = 0; r < rounds; r++) {
+      for (const auto& digit : digits) total += network.infer(digit).at(0);
+    }
+  });
+
+  std::cout << name << ": " 
+            << (unsigned)((rounds * digits.size() * 1.0e6)/std::max<uint64_t>(micros, 1)) 
+            << " samples/s (" << total << ")" << std::endl;
+}
+
+// Data-parallel training throughput, on a fresh network so the trained
+// one is left alone, with a batch of B shuffled training digits
+template <size_t B, typename Network>
+void benchmarkTraining(size_t threads, const MnistData& data) {
+  rook::EpochSampler sampler(data.size());
+  typename Network::template InputBatch<B> input;
+  rook::gatherBatch(data.image(0).data(), data.stride(), sampler.batch(0, B), pixelEncoding, input);
+  typename Network::template OutputBatch<B> target([&](size_t i, size_t j) -> float {
+    return (i == data.label(sampler[j]))?1.0f:0.0f;
+  });
+
+  Network                         network;
+  rook::ParallelTrainer<Network>  trainer(network, threads);
+  const size_t rounds = 4096/B;
+  auto micros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    for (size_t r = 0; r < rounds; r++) {
+      trainer.learnBatch(input, target);
+    }
+  });
+
+  std::cout << "Training on " << std::setw(2) << trainer.threads() << " threads: " 
+            << (unsigned)((rounds * B * 1.0e6)/std::max<uint64_t>(micros, 1)) 
+            << " samples/s" << std::endl;
+}
+
 //------------------------------------------------------------------------------
 
 int main () {
@@ -190,20 +244,40 @@ int main () {
 
   //----------------------------------------------------------------------------
   // Training Time
-  for (int i = 0; i < 4; i++)
-  trainingData.each([&](const MnistData::Image& image, const MnistData::Label& label) {
-    digit  = encodeImage(image);
-    output = encodeLabel(label);
-  
-    auto nanos = Stopwatch<std::chrono::microseconds>::clock([&] {
-      std::tie(ierror, oerror) = mnist.learn(digit, output);
-    });
-
-    std::cout << "Took "      << nanos           << "µs.  "
-              << "Learned a " << (unsigned)label << ".  "
-              << "Error was " << mag(oerror)     << std::endl;
+  // Samples are encoded on a background thread, a chunk ahead of training,
+  // in a fresh order every epoch.  Shuffling blocks of 256 keeps reads from
+  // the mapped file close together.
+  const size_t       epochs       = 4;
+  const float        learningRate = 0.1f;
+  uint64_t           trainMicros  = 0;
+  size_t             chunks       = 0;
+  size_t             cursor       = 0;
+  rook::EpochSampler sampler(trainingData.size(), 1, 256);
+  rook::Prefetcher<Chunk> prefetcher([&](Chunk& chunk) {
+    for (chunk.size = 0; chunk.size < Chunk::Capacity && cursor < epochs*trainingData.size(); chunk.size++, cursor++) {
+      const size_t n = cursor%trainingData.size();
+      if (n == 0 && cursor > 0) sampler.next();
+      const auto sample = trainingData[sampler[n]];
+      chunk.inputs[chunk.size]  = encodeImage(sample.image);
+      chunk.targets[chunk.size] = encodeLabel(sample.label);
+      chunk.labels[chunk.size]  = sample.label;
+    }
+    return chunk.size > 0;
   });
 
+  for (const Chunk* chunk; (chunk = prefetcher.next()); chunks++) {
+    for (size_t n = 0; n < chunk->size; n++) {
+      auto nanos = Stopwatch<std::chrono::microseconds>::clock([&] {
+        std::tie(ierror, oerror) = mnist.learn(chunk->inputs[n], chunk->targets[n], learningRate);
+      });
+      trainMicros += nanos;
+
+      std::cout << "Took "      << nanos                       << "µs.  "
+                << "Learned a " << (unsigned)chunk->labels[n]  << ".  "
+                << "Error was " << mag(oerror)                 << std::endl;
+    }
+  }
+
   //----------------------------------------------------------------------------
   // Test Time
   testData.each([&](const MnistData::Image& image, const MnistData::Label& label) {
@@ -220,10 +294,103 @@ int main () {
               << " (should be " << (unsigned)label << ")" << std::endl;
   });
   
-  std::cout << "Number of images: " << testData.numImages_ << std::endl;
+  std::cout << "Number of images: " << testData.size() << std::endl;
   std::cout << "Number correct: "   << correct   << std::endl;
   std::cout << "Test Error: " << std::setprecision(2) << std::fixed 
-            << (1.0f - (float)correct/(float)testData.numImages_) * 100.0f << "%" << std::endl;
+            << (1.0f - (float)correct/(float)testData.size()) * 100.0f << "%" << std::endl;
+
+  //----------------------------------------------------------------------------
+  // Checkpoint - save the trained network, and start a fresh one from it
+  rook::save("data/feedforward.ckpt", mnist);
+  // The mapping is declared first, so it outlives the matrices borrowing it
+  std::unique_ptr<rook::Checkpoint> checkpoint;
+  decltype(mnist)                   restored;
+  auto restoreMicros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    checkpoint.reset(new rook::Checkpoint("data/feedforward.ckpt"));
+    checkpoint->restore(restored);
+  });
+
+  std::cout << "Restored checkpoint in " << restoreMicros << "µs, Test Error: " 
+            << testError(restored, testData) << "%" << std::endl;
+
+  //----------------------------------------------------------------------------
+  // Hogwild - the same training on every core, with lock-free updates, in
+  // the same shuffled order and at the same rate
+  decltype(mnist)                        hogwild;
+  rook::HogwildTrainer<decltype(mnist)>  trainer(hogwild);
+  rook::EpochSampler                     order(trainingData.size(), 1, 256);
+  auto hogwildMicros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    for (size_t epoch = 0; epoch < epochs; epoch++) {
+      if (epoch > 0) order.next();
+      trainer.learn(trainingData.size(), [&](size_t n, InputLayer::Input& input, OutputLayer::Output& target) {
+        const auto sample = trainingData[order[n]];
+        input  = encodeImage(sample.image);
+        target = encodeLabel(sample.label);
+      }, learningRate);
+    }
+  });
+
+  std::cout << "Single-threaded: " << trainMicros/1000 << "ms, Test Error: " 
+            << (1.0f - (float)correct/(float)testData.size()) * 100.0f << "%" << std::endl;
+  std::cout << "Prefetch stalls: " << prefetcher.stalls() << " of " << chunks << " chunks" << std::endl;
+  std::cout << "Hogwild on " << trainer.threads() << " threads: " << hogwildMicros/1000 << "ms, Test Error: " 
+            << testError(hogwild, testData) << "%" << std::endl;
+
+  //----------------------------------------------------------------------------
+  // Pretraining - one epoch from a hidden layer initialized by a denoising
+  // autoencoder, against one epoch from scratch
+  const rook::FloatArena pixels(trainingData.pixels(0, trainingData.size()).data(), 
+                                trainingData.size(), 28*28, pixelEncoding);
+  rook::StackedAutoencoder<784, 350> stack;
+  auto pretrainMicros = Stopwatch<std::chrono::microseconds>::clock([&] {
+    stack.pretrain(pixels);
+  });
+
+  decltype(mnist) scratch, pretrained;
+  stack.initialize(pretrained);
+  for (size_t n = 0; n < trainingData.size(); n++) {
+    const auto input  = encodeImage(trainingData.image(n));
+    const auto target = encodeLabel(trainingData.label(n));
+    scratch.learn(input, target);
+    pretrained.learn(input, target);
+  }
+
+  std::cout << "One epoch from scratch: Test Error: " << testError(scratch, testData) << "%" << std::endl;
+  std::cout << "One epoch after " << pretrainMicros/1000 << "ms pretraining: Test Error: " 
+            << testError(pretrained, testData) << "%" << std::endl;
+
+  //----------------------------------------------------------------------------
+  // Quantization - int8 weights, with input ranges calibrated on the first 
+  // thousand training digits
+  std::vector<InputLayer::Input> calibration, digits;
+  for (size_t n = 0; n < std::min<size_t>(1000, trainingData.size()); n++) {
+    calibration.push_back(encodeImage(trainingData.image(n)));
+  }
+  for (size_t n = 0; n < std::min<size_t>(1000, testData.size()); n++) {
+    digits.push_back(encodeImage(testData.image(n)));
+  }
+  const rook::QuantizedNetwork<decltype(mnist)> quantized(mnist, calibration);
+
+  const float  floatError = testError(mnist, testData);
+  const float  int8Error  = testError(quantized, testData);
+  const size_t floatBytes = (784*350 + 350 + 350*10 + 10)*sizeof(float);
+  std::cout << "Int8 Test Error: " << int8Error << "% (float " << floatError << "%, " 
+            << std::showpos << int8Error - floatError << std::noshowpos << ")" << std::endl;
+  std::cout << "Int8 weights: " << quantized.weightBytes()/1024 << "KB (float " 
+            << floatBytes/1024 << "KB)" << std::endl;
+
+  //----------------------------------------------------------------------------
+  // Throughput
+  benchmarkBatch<  1>(mnist, testData);
+  benchmarkBatch<  8>(mnist, testData);
+  benchmarkBatch< 32>(mnist, testData);
+  benchmarkBatch<128>(mnist, testData);
+  benchmarkPipeline(mnist, digit);
+  benchmarkSingle("Float single", mnist,     digits);
+  benchmarkSingle("Int8 single ", quantized, digits);
+
+  benchmarkTraining<128, decltype(mnist)>(1, trainingData);
+  benchmarkTraining<128, decltype(mnist)>(std::thread::hardware_concurrency(), trainingData);
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "MnistData.h"
+#include "Check.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the memory-mapped IDX loader, against small files
+ * written on the spot: good files load in place, and every malformed 
+ * header is rejected with std::runtime_error.
+ *
+ */
+
+// A scratch file, removed again on the way out
+struct ScratchFile {
+  ScratchFile(const std::string& name, const std::vector<uint8_t>& bytes) 
+  : path(scratchPath(name)) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+
+  ~ScratchFile() {
+    std::remove(path.c_str());
+  }
+
+  std::string path;
+};
+
+// Header for an IDX file of unsigned bytes with the given dimensions
+std::vector<uint8_t> header(const std::vector<uint32_t>& dimensions) {
+  std::vector<uint8_t> bytes = {0, 0, 0x08, (uint8_t)dimensions.size()};
+  for (auto d : dimensions) {
+    bytes.push_back(d >> 24);
+    bytes.push_back(d >> 16);
+    bytes.push_back(d >>  8);
+    bytes.push_back(d);
+  }
+  return bytes;
+}
+
+bool rejects(const std::vector<uint8_t>& images, const std::vector<uint8_t>& labels) {
+  ScratchFile imageFile("bad-images", images), labelFile("bad-labels", labels);
+  try {
+    rook::IdxDataset data(imageFile.path, labelFile.path);
+  } catch (const std::runtime_error&) {
+    return true;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Three 2x3 images, with pixel values that give away their position
+  std::vector<uint8_t> images = header({3, 2, 3});
+  std::vector<uint8_t> labels = header({3});
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t p = 0; p < 6; p++) {
+      images.push_back(10*i + p);
+    }
+    labels.push_back(7 - i);
+  }
+
+  {
+    ScratchFile imageFile("images", images), labelFile("labels", labels);
+    const rook::IdxDataset data(imageFile.path, labelFile.path);
+    check("shape", data.size() == 3 && data.rows() == 2 && data.cols() == 3);
+
+    bool ok = true;
+    for (size_t i = 0; i < 3; i++) {
+      const rook::ByteSpan image = data.image(i);
+      ok = ok && image.size() == 6 && image[5] == 10*i + 5 && data.label(i) == 7 - i;
+    }
+    check("images and labels", ok);
+    check("zero-copy", data.image(1).data() == data.image(0).data() + 6);
+
+    // MnistData hands out the same views by index, range and batch
+    const rook::MnistData mnist(imageFile.path, labelFile.path);
+    size_t i = 0;
+    ok = true;
+    for (const auto& sample : mnist) {
+      ok = ok && sample.image[0] == 10*i && sample.label == 7 - i;
+      i++;
+    }
+    check("MnistData range", ok && i == 3);
+
+    const rook::ByteSpan pixels = mnist.pixels(1, 2);
+    const rook::ByteSpan labels = mnist.labels(1, 2);
+    check("MnistData batch", pixels.size() == 12 && pixels[6] == 20 && labels[1] == 5);
+  }
+
+  // Malformed files
+  std::vector<uint8_t> badMagic = images;
+  badMagic[0] = 1;
+  std::vector<uint8_t> badType = images;
+  badType[2] = 0x0D;
+  std::vector<uint8_t> truncated(images.begin(), images.end() - 1);
+  std::vector<uint8_t> shortHeader(images.begin(), images.begin() + 9);
+  std::vector<uint8_t> fewerLabels = header({2});
+  fewerLabels.push_back(1);
+  fewerLabels.push_back(2);
+
+  check("rejects bad magic",          rejects(badMagic,    labels));
+  check("rejects non-byte data",      rejects(badType,     labels));
+  check("rejects truncated data",     rejects(truncated,   labels));
+  check("rejects truncated header",   rejects(shortHeader, labels));
+  check("rejects mismatched counts",  rejects(images,      fewerLabels));
+  check("rejects labels as images",   rejects(labels,      labels));
+
+  bool missing = false;
+  try {
+    rook::IdxFile file("/nonexistent/rook-idx");
+  } catch (const std::runtime_error&) {
+    missing = true;
+  }
+  check("rejects missing file", missing);
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
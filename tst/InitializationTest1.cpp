@@ -0,0 +1,172 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "DynamicLayer.h"
+#include "Layer.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for weight initialization: every scheme has the moments it
+ * promises, fills are the same for the same seed however many threads 
+ * draw them, and layers made on several threads at once are all different.
+ *
+ */
+
+// Mean, variance, and bounds of n values
+struct Moments {
+  Moments(const float* x, size_t n) 
+  : mean(0.0), variance(0.0), low(x[0]), high(x[0]) {
+    for (size_t i = 0; i < n; i++) {
+      mean += x[i];
+      low   = std::min(low,  x[i]);
+      high  = std::max(high, x[i]);
+    }
+    mean /= n;
+    for (size_t i = 0; i < n; i++) {
+      variance += (x[i] - mean)*(x[i] - mean);
+    }
+    variance /= n;
+  }
+
+  double mean, variance;
+  float  low, high;
+};
+
+bool near(double a, double b, double tolerance) {
+  return std::fabs(a - b) <= tolerance;
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Enough pool threads to fill in parallel on any machine
+  setenv("ROOK_THREADS", "4", 0);
+
+  const size_t n = 350*784;
+  std::vector<float> x(n), y(n);
+
+  // Each scheme's moments
+  {
+    rook::Initialization::normal(1.0f, 0.5f).fill(x.data(), n, 7);
+    Moments normal(x.data(), n);
+    check("normal", near(normal.mean, 1.0, 0.005) && near(normal.variance, 0.25, 0.005));
+
+    rook::Initialization::uniform(-1.0f, 3.0f).fill(x.data(), n, 7);
+    Moments uniform(x.data(), n);
+    check("uniform", near(uniform.mean, 1.0, 0.01) && near(uniform.variance, 16.0/12.0, 0.01) &&
+                     uniform.low >= -1.0f && uniform.high <= 3.0f);
+
+    rook::Initialization::xavier(784, 350).fill(x.data(), n, 7);
+    Moments xavier(x.data(), n);
+    check("xavier", near(xavier.mean, 0.0, 0.001) && near(xavier.variance, 2.0/(784 + 350), 0.0001));
+
+    rook::Initialization::xavierUniform(784, 350).fill(x.data(), n, 7);
+    Moments xavierUniform(x.data(), n);
+    const float limit = std::sqrt(6.0f/(784 + 350));
+    check("xavier uniform", near(xavierUniform.variance, 2.0/(784 + 350), 0.0001) && 
+                            xavierUniform.low >= -limit && xavierUniform.high <= limit);
+
+    rook::Initialization::he(784).fill(x.data(), n, 7);
+    Moments he(x.data(), n);
+    check("he", near(he.mean, 0.0, 0.001) && near(he.variance, 2.0/784, 0.0001));
+
+    rook::Initialization::heUniform(784).fill(x.data(), n, 7);
+    Moments heUniform(x.data(), n);
+    check("he uniform", near(heUniform.variance, 2.0/784, 0.0001));
+  }
+
+  // The same seed gives the same values, serially or in parallel
+  {
+    const size_t threshold = rook::parallelThreshold();
+    rook::parallelThreshold() = 0;
+    rook::Initialization::normal(0.0f, 1.0f).fill(x.data(), n, 11);
+    rook::parallelThreshold() = (size_t)-1;
+    rook::Initialization::normal(0.0f, 1.0f).fill(y.data(), n, 11);
+    rook::parallelThreshold() = threshold;
+    check("fill is repeatable", x == y && rook::globalPool().size() > 1);
+
+    rook::Initialization::normal(0.0f, 1.0f).fill(y.data(), n, 12);
+    check("fill depends on seed", x != y);
+  }
+
+  // Seeded layers are the same every time, and generators have their own
+  // parameters
+  {
+    typedef rook::Layer<784, 350> Big;
+    rook::seedInitialization(99);
+    Big a;
+    rook::seedInitialization(99);
+    Big b;
+    Big c;
+    check("seeded layers", a.getWeightMatrix() == b.getWeightMatrix() && a.getBias() == b.getBias() &&
+                           !(b.getWeightMatrix() == c.getWeightMatrix()));
+
+    const rook::Matrix<100, 100> wide(rook::normal(5.0f, 2.0f));
+    const rook::Matrix<100, 100> narrow(rook::normal(-5.0f, 0.1f));
+    Moments w(wide.raw().data(), 10000), v(narrow.raw().data(), 10000);
+    check("generators", near(w.mean, 5.0, 0.1) && near(w.variance, 4.0, 0.3) &&
+                        near(v.mean, -5.0, 0.01) && near(v.variance, 0.01, 0.001));
+
+    const auto generator = rook::normal(0.0f, 1.0f);
+    const auto copy      = generator;
+    const rook::Matrix<10, 10> first(generator), second(copy);
+    check("copied generators", !(first == second));
+
+    rook::DynamicLayer dynamic(784, 350, rook::Initialization::he(784));
+    Moments d(dynamic.getWeightMatrix().data(), n);
+    check("dynamic layer", near(d.variance, 2.0/784, 0.0001));
+  }
+
+  // Layers made on several threads at once
+  {
+    typedef rook::Layer<60, 20> Small;
+    std::vector<Small> layers(8);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < layers.size(); t++) {
+      threads.emplace_back([&layers, t] { layers[t] = Small(rook::Initialization::xavier(60, 20)); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    bool distinct = true;
+    for (size_t i = 0; i < layers.size(); i++) {
+      for (size_t j = i + 1; j < layers.size(); j++) {
+        distinct = distinct && !(layers[i].getWeightMatrix() == layers[j].getWeightMatrix());
+      }
+    }
+    check("concurrent layers", distinct);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,400 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "ParallelTrainer.h"
+#include "HogwildTrainer.h"
+#include "Pipeline.h"
+#include "StackedAutoencoder.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <chrono>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the Layer and FeedForwardNetwork batch paths.  A batch
+ * of one sample must match the single-sample path exactly, and a batch of B
+ * must match B independent forward passes.
+ *
+ */
+
+float uniform(size_t i, size_t j) {
+  return (float)(rand()%1001)/1000.0f;
+}
+
+// Largest relative error of an activation's vectorized kernels against its
+// scalar versions, over n points spread across [lo, hi]
+template <typename Activation, typename Precision>
+float activationError(float lo, float hi, size_t n) {
+  std::vector<float> z(n), y(n), d(n);
+  for (size_t i = 0; i < n; i++) {
+    z[i] = lo + (hi - lo)*i/(n - 1);
+  }
+  Activation::template activate<Precision>(z.data(), y.data(), n);
+  Activation::derive(y.data(), d.data(), n);
+
+  float worst = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    const float ey = Activation::activation(z[i]);
+    const float ed = Activation::derivative(y[i]);
+    worst = std::max(worst, std::fabs(y[i] - ey)/std::max(1.0f, std::fabs(ey)));
+    worst = std::max(worst, std::fabs(d[i] - ed)/std::max(1.0f, std::fabs(ed)));
+  }
+  return worst;
+}
+
+typedef rook::Layer<60, 20> InputLayer;
+typedef rook::Layer<20,  5> OutputLayer;
+typedef rook::FeedForwardNetwork<InputLayer, OutputLayer> Network;
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Vectorized activations track the scalar ones; odd sizes cover the tail
+  {
+    using rook::math::Bounded;
+    using rook::math::Fast;
+    check("Sigmoid kernels",      activationError<rook::Sigmoid, Bounded>(-90.0f, 90.0f, 10001) < 1.0e-6f);
+    check("Sigmoid fast kernels", activationError<rook::Sigmoid, Fast>   (-90.0f, 90.0f, 10001) < 1.0e-4f);
+    // The Sinc derivative cancels catastrophically as y -> 0, in either form
+    check("Sinc kernels",         activationError<rook::Sinc,    Bounded>(-50.0f, 50.0f, 10001) < 1.0e-2f);
+    check("Hinge kernels",        activationError<rook::Hinge,   Bounded>(-10.0f, 10.0f,  1001) == 0.0f);
+    check("Linear kernels",       activationError<rook::Linear,  Bounded>(-10.0f, 10.0f,    13) == 0.0f);
+  }
+
+  // Batched inference is B independent forward passes
+  {
+    InputLayer layer;
+    const InputLayer::InputBatch<8> x(uniform);
+    const auto y = layer.inferBatch(x);
+    bool ok = true;
+    for (size_t b = 0; b < 8; b++) {
+      ok = ok && close(y.col(b), layer.infer(x.col(b)));
+    }
+    check("Layer::inferBatch", ok);
+  }
+
+  {
+    Network network;
+    const Network::InputBatch<8> x(uniform);
+    const auto y = network.inferBatch(x);
+    bool ok = true;
+    for (size_t b = 0; b < 8; b++) {
+      ok = ok && close(y.col(b), network.infer(x.col(b)));
+    }
+    check("FeedForwardNetwork::inferBatch", ok);
+  }
+
+  // A batch of one is a single learning step
+  {
+    InputLayer single;
+    InputLayer batched = single;
+    InputLayer::Input  x(uniform);
+    InputLayer::Output t(uniform);
+
+    const auto e1 = single.learn(x, single.infer(x), t);
+    const auto e2 = batched.learnBatch<1>(x, batched.inferBatch<1>(x), t);
+    check("Layer::learnBatch<1> weights", close(single.getWeightMatrix(), batched.getWeightMatrix()));
+    check("Layer::learnBatch<1> bias",    close(single.getBias(), batched.getBias()));
+    check("Layer::learnBatch<1> error",   close(std::get<0>(e1), std::get<0>(e2)));
+  }
+
+  // A batch of B applies the mean of the B single-sample updates
+  {
+    InputLayer base;
+    InputLayer batched = base;
+    const InputLayer::InputBatch<4>  x(uniform);
+    const InputLayer::OutputBatch<4> t(uniform);
+    batched.learnBatch<4>(x, batched.inferBatch<4>(x), t);
+
+    InputLayer::WeightMatrix expected = base.getWeightMatrix();
+    for (size_t b = 0; b < 4; b++) {
+      InputLayer sample = base;
+      sample.learn(x.col(b), base.infer(x.col(b)), t.col(b), 0.1f/4);
+      expected += sample.getWeightMatrix();
+      expected -= base.getWeightMatrix();
+    }
+    check("Layer::learnBatch<4> weights", close(expected, batched.getWeightMatrix()));
+  }
+
+  // The same holds for a whole network
+  {
+    Network single, batched;
+    batched.getLayer()                    = single.getLayer();
+    batched.getRemainNetwork().getLayer() = single.getRemainNetwork().getLayer();
+
+    Network::Input  x(uniform);
+    Network::Output t(uniform);
+    single.learn(x, t);
+    batched.learnBatch<1>(x, t);
+    check("FeedForwardNetwork::learnBatch<1>", 
+          close(single.getLayer().getWeightMatrix(), batched.getLayer().getWeightMatrix()) &&
+          close(single.getRemainNetwork().getLayer().getWeightMatrix(), 
+                batched.getRemainNetwork().getLayer().getWeightMatrix()));
+  }
+
+  // learn() honors its learning rate at every layer, as learnBatch() does
+  {
+    Network slow, fast, batched;
+    fast.getLayer()                       = slow.getLayer();
+    fast.getRemainNetwork().getLayer()    = slow.getRemainNetwork().getLayer();
+    batched.getLayer()                    = slow.getLayer();
+    batched.getRemainNetwork().getLayer() = slow.getRemainNetwork().getLayer();
+
+    Network::Input  x(uniform);
+    Network::Output t(uniform);
+    slow.learn(x, t, 0.1f);
+    fast.learn(x, t, 0.5f);
+    batched.learnBatch<1>(x, t, 0.5f);
+    check("FeedForwardNetwork::learn rate",
+          !close(slow.getLayer().getWeightMatrix(), fast.getLayer().getWeightMatrix()) &&
+          !close(slow.getRemainNetwork().getLayer().getWeightMatrix(),
+                 fast.getRemainNetwork().getLayer().getWeightMatrix()) &&
+          close(fast.getLayer().getWeightMatrix(), batched.getLayer().getWeightMatrix()) &&
+          close(fast.getRemainNetwork().getLayer().getWeightMatrix(),
+                batched.getRemainNetwork().getLayer().getWeightMatrix()));
+  }
+
+  // Data-parallel training makes the same update as one thread would
+  {
+    Network serial, parallel;
+    parallel.getLayer()                    = serial.getLayer();
+    parallel.getRemainNetwork().getLayer() = serial.getRemainNetwork().getLayer();
+
+    const Network::InputBatch<32>  x(uniform);
+    const Network::OutputBatch<32> t(uniform);
+
+    Network::Gradient gradient;
+    const auto expected = serial.gradientBatch(x, t, gradient);
+    serial.apply(gradient, 0.1f/32);
+
+    rook::ParallelTrainer<Network, 8> trainer(parallel, 3);
+    const auto loss = trainer.learnBatch(x, t);
+    check("ParallelTrainer::learnBatch loss", close(loss, std::get<1>(expected)));
+    check("ParallelTrainer::learnBatch weights", 
+          close(serial.getLayer().getWeightMatrix(), parallel.getLayer().getWeightMatrix()) &&
+          close(serial.getRemainNetwork().getLayer().getBias(), 
+                parallel.getRemainNetwork().getLayer().getBias()));
+  }
+
+  // Hogwild training on one thread is plain sequential learn(), and on 
+  // several still visits every sample exactly once and learns
+  {
+    std::vector<Network::Input>  inputs;
+    std::vector<Network::Output> targets;
+    Network teacher;
+    for (size_t i = 0; i < 200; i++) {
+      inputs.emplace_back(uniform);
+      targets.push_back(teacher.infer(inputs.back()));
+    }
+    auto sample = [&](size_t i, Network::Input& x, Network::Output& t) {
+      x = inputs[i];
+      t = targets[i];
+    };
+    auto loss = [&](Network& network) {
+      double total = 0.0;
+      for (size_t i = 0; i < inputs.size(); i++) {
+        const auto y = network.infer(inputs[i]);
+        for (size_t k = 0; k < y.raw().size(); k++) {
+          total += (y.raw()[k] - targets[i].raw()[k])*(y.raw()[k] - targets[i].raw()[k]);
+        }
+      }
+      return total;
+    };
+
+    Network serial, hogwild;
+    hogwild.getLayer()                    = serial.getLayer();
+    hogwild.getRemainNetwork().getLayer() = serial.getRemainNetwork().getLayer();
+    for (size_t i = 0; i < inputs.size(); i++) {
+      serial.learn(inputs[i], targets[i], 0.1f);
+    }
+    rook::HogwildTrainer<Network> single(hogwild, 1);
+    single.learn(inputs.size(), sample, 0.1f);
+    check("HogwildTrainer on one thread", 
+          serial.getLayer().getWeightMatrix()                    == hogwild.getLayer().getWeightMatrix() &&
+          serial.getLayer().getBias()                            == hogwild.getLayer().getBias() &&
+          serial.getRemainNetwork().getLayer().getWeightMatrix() == hogwild.getRemainNetwork().getLayer().getWeightMatrix() &&
+          serial.getRemainNetwork().getLayer().getBias()         == hogwild.getRemainNetwork().getLayer().getBias());
+
+    Network network;
+    rook::HogwildTrainer<Network> trainer(network, 4);
+    std::vector<std::atomic<size_t>> calls(inputs.size());
+    trainer.learn(inputs.size(), [&](size_t i, Network::Input& x, Network::Output& t) {
+      calls[i]++;
+      sample(i, x, t);
+    }, 0.1f);
+    bool once = true;
+    for (const auto& c : calls) once = once && c == 1;
+    check("HogwildTrainer samples each index once", once);
+
+    const double before = loss(network);
+    for (size_t epoch = 0; epoch < 20; epoch++) {
+      trainer.learn(inputs.size(), sample, 0.5f);
+    }
+    check("HogwildTrainer learns", loss(network) < 0.5*before);
+  }
+
+  // A loop body that throws stops the loop, and the exception reaches the
+  // caller once every thread is done with the body; the pool is still 
+  // usable, in parallel, afterwards
+  {
+    rook::ThreadPool pool(4);
+    std::atomic<size_t> ran(0);
+    bool thrown = false;
+    try {
+      pool.parallel(1000, [&](size_t) {
+        ran++;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        throw std::runtime_error("loop body");
+      });
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    check("ThreadPool::parallel rethrows", thrown && ran <= pool.size());
+
+    std::mutex                 mutex;
+    std::set<std::thread::id>  threads;
+    std::atomic<size_t>        count(0);
+    pool.parallel(64, [&](size_t) {
+      count++;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    check("ThreadPool::parallel after a throw", count == 64 && threads.size() > 1);
+  }
+
+  // Pipelined inference streams the same outputs, in order
+  {
+    typedef rook::FeedForwardNetwork<InputLayer, rook::Layer<20, 20>, OutputLayer> Deep;
+    Deep network;
+    std::vector<Deep::Input> inputs;
+    for (size_t i = 0; i < 500; i++) {
+      inputs.push_back(Deep::Input(uniform));
+    }
+
+    rook::Pipeline<Deep> pipeline(network, 4);
+    std::thread producer([&] {
+      for (const auto& input : inputs) pipeline.push(input);
+    });
+    bool ok = true;
+    for (const auto& input : inputs) {
+      ok = ok && close(pipeline.pop(), network.infer(input));
+    }
+    producer.join();
+    check("Pipeline", ok);
+  }
+
+  // The autoencoder's encoder is the transpose of its decoder, and learning
+  // puts both halves' updates into the one shared matrix - as if encoder
+  // and decoder were separate layers whose updates were then summed
+  {
+    typedef rook::Autoencoder<60, 20> Autoencoder;
+    Autoencoder autoencoder;
+    const Autoencoder::Input x(uniform);
+
+    const auto w = autoencoder.getWeightMatrix();
+    rook::Layer<60, 20>  encoder(w.transpose(), autoencoder.encoderBias);
+    Autoencoder::Decoder decoder = autoencoder.decoder;
+    check("Autoencoder::encode", close(autoencoder.encode(x), encoder.infer(x)));
+
+    rook::CounterRandom random(5);
+    const Autoencoder::Input corrupted = autoencoder.corruption.apply(x, random);
+    const auto code  = encoder.infer(corrupted);
+    const auto recon = decoder.infer(code);
+    const auto error = decoder.learn(code, recon, x, 0.1f);
+    encoder.correct(corrupted, code, std::get<0>(error), 0.1f);
+    const rook::Matrix<20, 60> encoderUpdate = encoder.getWeightMatrix() - w.transpose();
+    const rook::Matrix<60, 20> expected = decoder.getWeightMatrix() + encoderUpdate.transpose();
+
+    rook::threadRandom() = rook::CounterRandom(5);
+    autoencoder.learn(x, 0.1f);
+    check("Autoencoder::learn", close(autoencoder.getWeightMatrix(), expected) &&
+                                close(autoencoder.encoderBias, encoder.getBias()) &&
+                                close(autoencoder.decoder.getBias(), decoder.getBias()));
+  }
+
+  // Stacked pretraining caches each level's codes, in memory or a mapped 
+  // file, and its encoders initialize the network's first layers
+  {
+    std::vector<uint8_t> bytes(200*60);
+    for (auto& b : bytes) b = rand()%256;
+    const rook::FloatArena data(bytes.data(), 200, 60, rook::Encoding::unit(60));
+
+    // A directory of this process's own, so concurrent runs don't share codes
+    std::string cache = scratchPath("codes-XXXXXX");
+    check("cache directory", mkdtemp(&cache[0]) != nullptr);
+    for (const auto& directory : {std::string(), cache}) {
+      typedef rook::StackedAutoencoder<60, 20, 10> Stack;
+      Stack stack;
+      stack.pretrain(data, rook::Pretraining(2, 0.01f, 1, directory));
+
+      bool ok = stack.codes().size() == 200 && stack.remain.codes().size() == 200;
+      for (size_t i = 0; i < 200; i += 17) {
+        Stack::Level::Input x;
+        std::copy(data.sample(i), data.sample(i) + 60, x.raw().begin());
+        const auto code = stack.level.encode(x);
+        ok = ok && std::equal(code.raw().begin(), code.raw().end(), stack.codes().sample(i));
+      }
+
+      rook::FeedForwardNetwork<InputLayer, rook::Layer<20, 10>, rook::Layer<10, 5>> network;
+      const auto head = network.getRemainNetwork().getRemainNetwork().getLayer().getWeightMatrix();
+      stack.initialize(network);
+      const InputLayer::Input x(uniform);
+      ok = ok && close(network.getLayer().infer(x), stack.level.encode(x)) &&
+                 close(network.getRemainNetwork().getLayer().infer(stack.level.encode(x)), 
+                       stack.remain.level.encode(stack.level.encode(x))) &&
+                 network.getRemainNetwork().getRemainNetwork().getLayer().getWeightMatrix() == head;
+      check(directory.empty() ? "StackedAutoencoder" : "StackedAutoencoder cached to disk", ok);
+
+      // A network with just one layer per level
+      rook::FeedForwardNetwork<InputLayer, rook::Layer<20, 10>> encoders;
+      stack.initialize(encoders);
+      check("StackedAutoencoder initializes every layer", 
+            close(encoders.infer(x), stack.remain.level.encode(stack.level.encode(x))));
+
+      if (!directory.empty()) {
+        std::remove((directory + "/codes-1.bin").c_str());
+        std::remove((directory + "/codes-2.bin").c_str());
+      }
+    }
+    rmdir(cache.c_str());
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
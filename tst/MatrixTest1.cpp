@@ -0,0 +1,273 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "Matrix.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the Matrix kernels.  Every optimized path is compared
+ * against a plain triple loop.  Every check runs, and the process exits 
+ * non-zero if any of them failed.
+ *
+ */
+
+float uniform(size_t i, size_t j) {
+  return (float)(rand()%2001 - 1000)/1000.0f;
+}
+
+template <size_t M, size_t L, size_t N>
+rook::Matrix<M, N> reference(const rook::Matrix<M, L>& a, const rook::Matrix<L, N>& b) {
+  rook::Matrix<M, N> result;
+  for (size_t i = 0; i < M; i++) {
+    for (size_t j = 0; j < N; j++) {
+      for (size_t k = 0; k < L; k++) {
+        result.at(i, j) += a.at(i, k) * b.at(k, j);
+      }
+    }
+  }
+  return result;
+}
+
+// Large operands live in static storage to keep them off the stack
+template <size_t M, size_t L, size_t N>
+void checkMultiply(const std::string& name) {
+  static rook::Matrix<M, L> a(uniform);
+  static rook::Matrix<L, N> b(uniform);
+  check(name, close(a * b, reference(a, b)));
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Enough pool threads to exercise the parallel kernels on any machine
+  setenv("ROOK_THREADS", "4", 0);
+
+  // Naive path
+  checkMultiply<  3,   4,   5>("multiply 3x4 * 4x5");
+  checkMultiply< 10, 350,   1>("multiply 10x350 * 350x1");
+
+  // Skinny path, including masked column tails and row tails
+  checkMultiply<350, 784,   5>("multiply 350x784 * 784x5");
+  checkMultiply< 37, 301,  20>("multiply 37x301 * 301x20");
+  checkMultiply< 10, 350,   8>("multiply 10x350 * 350x8");
+
+  // Blocked path, including partial micro-tiles and multiple KC/MC panels
+  checkMultiply< 64,  64,  64>("multiply 64x64 * 64x64");
+  checkMultiply< 37, 301,  53>("multiply 37x301 * 301x53");
+  checkMultiply<350, 784,  32>("multiply 350x784 * 784x32");
+  checkMultiply<130, 520, 200>("multiply 130x520 * 520x200");
+
+  // Strided operands: C = A' * B without materializing A'
+  {
+    static rook::Matrix<300, 40> a(uniform);
+    static rook::Matrix<300, 50> b(uniform);
+    rook::Matrix<40, 50> c;
+    rook::gemm::gemm(40, 50, 300, 1.0f,
+                     a.raw().data(), 1, 40,
+                     b.raw().data(), 50, 1,
+                     c.raw().data(), 50, 1);
+    check("gemm A' * B", close(c, reference(a.transpose(), b)));
+  }
+
+  // Matrix-vector products, with row and column tails
+  {
+    static rook::Matrix<350, 784> a(uniform);
+    rook::ColVector<784> x(uniform);
+    rook::ColVector<350> y(uniform);
+    check("gemv 350x784",   close(gemv(a, x),   reference(a, x)));
+    check("gemv_t 350x784", close(gemv_t(a, y), reference(a.transpose(), y)));
+  }
+  {
+    rook::Matrix<7, 13> a(uniform);
+    rook::ColVector<13> x(uniform);
+    rook::ColVector<7>  y(uniform);
+    check("gemv 7x13",   close(gemv(a, x),   reference(a, x)));
+    check("gemv_t 7x13", close(gemv_t(a, y), reference(a.transpose(), y)));
+  }
+
+  // Rank-1 updates, alone and fused with the back propagation product
+  {
+    static rook::Matrix<350, 787> a(uniform);
+    const rook::ColVector<350> u(uniform), w(uniform);
+    const rook::ColVector<787> v(uniform);
+
+    rook::Matrix<350, 787> expected = a + reference(u, v.transpose());
+    rook::Matrix<350, 787> b = a;
+    rook::gemm::ger(350, 787, u.raw().data(), v.raw().data(), b.raw().data(), 787);
+    check("ger 350x787", close(b, expected));
+
+    rook::ColVector<787> y;
+    rook::gemm::gerGemvT(350, 787, u.raw().data(), v.raw().data(), a.raw().data(), 787,
+                         w.raw().data(), y.raw().data());
+    check("gerGemvT 350x787", close(a, expected) && close(y, reference(expected.transpose(), w)));
+  }
+
+  // Storage policies: big matrices default to aligned heap storage, move
+  // without copying, and mix freely with inline ones
+  {
+    typedef rook::Matrix<350, 784>                     Big;
+    typedef rook::Matrix<350, 784, float, rook::Inline> BigInline;
+    static_assert(std::is_same<Big::StoragePolicy, rook::Heap>::value, "heap by default");
+    static_assert(std::is_same<rook::ColVector<784>::StoragePolicy, rook::Inline>::value, "inline by default");
+
+    Big a(uniform);
+    check("heap storage is aligned", (uintptr_t)a.raw().data() % rook::Alignment == 0);
+
+    const float* data = a.raw().data();
+    Big b(std::move(a));
+    check("heap storage moves", b.raw().data() == data);
+
+    Big c(b);
+    c.at(3, 5) += 1.0f;
+    check("heap storage copies", c.raw().data() != data && c.at(3, 5) != b.at(3, 5));
+
+    static BigInline d;
+    d.raw() = b.raw();
+    rook::ColVector<784> x(uniform);
+    check("mixed storage", close(gemv(d, x), gemv(b, x)) && (d == b));
+  }
+
+  // Element-wise expressions are evaluated lazily, in one pass
+  {
+    typedef rook::Matrix<5, 7> M57;
+    const M57 a(uniform), b(uniform), c(uniform);
+
+    const M57 fused = (a + b - a % c).apply([](float x) { return 2.0f*x; });
+    bool ok = true;
+    for (size_t i = 0; i < 5; i++) {
+      for (size_t j = 0; j < 7; j++) {
+        ok = ok && close(fused.at(i, j), 2.0f*(a.at(i, j) + b.at(i, j) - a.at(i, j)*c.at(i, j)));
+      }
+    }
+    check("fused expression", ok);
+
+    // Temporaries are held by value, so a saved expression can't dangle
+    const auto lazy = M57(a) + b;
+    M57 sum = a;
+    sum += b;
+    check("saved expression", close(M57(lazy), sum));
+
+    M57 acc = a;
+    acc -= a - b;
+    check("compound assignment", close(acc, b));
+  }
+
+  // Element-wise operations take lambdas, functors and std::function alike
+  {
+    typedef rook::Matrix<3, 4> M34;
+    std::function<float (size_t, size_t)> indexed = [](size_t i, size_t j) -> float {
+      return (float)(i*10 + j);
+    };
+    const M34 a(indexed);
+    const M34 b([](size_t i, size_t j) -> float { return (float)(i*10 + j); });
+    const rook::ColVector<5> v([](size_t i) -> float { return (float)i; });
+    check("generators", a == b && v.at(4) == 4.0f);
+
+    std::function<float (float)> twice = [](float x) { return 2.0f*x; };
+    const M34 c = a.apply(twice);
+    const M34 d = b.apply([](float x) { return 2.0f*x; });
+    check("apply", c == d && d.at(2, 3) == 46.0f);
+
+    size_t rows = 0;
+    a.eachRow([&](size_t i, const M34::Row& row) { rows += (row.at(3) == a.at(i, 3)); });
+    check("eachRow", rows == 3);
+  }
+
+  // Every kernel split across the shared pool matches the reference
+  {
+    const size_t threshold = rook::parallelThreshold();
+    rook::parallelThreshold() = 0;
+
+    checkMultiply<130, 520, 200>("parallel multiply 130x520 * 520x200");
+    checkMultiply<350, 784,   5>("parallel multiply 350x784 * 784x5");
+
+    static rook::Matrix<350, 787> a(uniform);
+    const rook::ColVector<787> x(uniform);
+    const rook::ColVector<350> y(uniform), u(uniform);
+    check("parallel gemv",   close(gemv(a, x),   reference(a, x)));
+    check("parallel gemv_t", close(gemv_t(a, y), reference(a.transpose(), y)));
+
+    rook::Matrix<350, 787> expected = a + reference(u, x.transpose());
+    rook::ColVector<787> z;
+    rook::gemm::gerGemvT(350, 787, u.raw().data(), x.raw().data(), a.raw().data(), 787,
+                         y.raw().data(), z.raw().data());
+    check("parallel gerGemvT", close(a, expected) && close(z, reference(expected.transpose(), y)));
+
+    rook::Matrix<350, 787> b = a;
+    b -= a % a;
+    bool ok = true;
+    for (size_t i = 0; i < 350; i++) {
+      for (size_t j = 0; j < 787; j++) {
+        ok = ok && close(b.at(i, j), a.at(i, j) - a.at(i, j)*a.at(i, j));
+      }
+    }
+    check("parallel element-wise", ok && rook::globalPool().size() > 1);
+
+    // Type-erased callables may keep state, so are only run on one thread
+    size_t calls = 0;
+    std::function<float (float)> counted = [&calls](float x) { calls++; return x; };
+    b = a.apply(counted);
+    check("serial std::function apply", calls == 350*787 && b == a);
+
+    // So are lambdas that capture, even trivially copyable ones
+    double sum = 0.0, expectedSum = 0.0;
+    for (auto x : a.raw()) expectedSum += x;
+    b = a.apply([&sum](float x) { sum += x; return x; });
+    check("serial capturing apply", sum == expectedSum && b == a);
+
+    // Capture-less and pure() callables are run across the pool
+    float      scale   = 0.5f;
+    const auto halve   = [](float x) { return x*0.5f; };
+    const auto scaled  = [=](float x) { return x*scale; };
+    const auto vouched = rook::pure(scaled);
+    const rook::Matrix<350, 787> halved = a.apply(halve);
+    b = a.apply(vouched);
+    check("parallel pure apply", b == halved);
+    check("apply concurrency", 
+          rook::IsConcurrent<decltype(a.apply(halve))>::value &&
+          rook::IsConcurrent<decltype(a.apply(vouched))>::value &&
+          !rook::IsConcurrent<decltype(a.apply(scaled))>::value);
+
+    rook::parallelThreshold() = threshold;
+  }
+
+#ifdef SHAPE_MISMATCH
+  // Must not compile
+  rook::Matrix<3, 4> p;
+  rook::Matrix<4, 3> q;
+  rook::Matrix<3, 4> r = p + q;
+#endif
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "Quantized.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <thread>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for int8 inference: the SIMD dot products are exact, a 
+ * quantized layer computes what its integers say it should, and a 
+ * quantized network stays close to the float one in a quarter of the 
+ * memory.
+ *
+ */
+
+float uniform(size_t i) {
+  return (float)(rand()%1001)/1000.0f;
+}
+
+template <size_t N>
+size_t argmax(const rook::ColVector<N>& v) {
+  size_t best = 0;
+  for (size_t i = 1; i < N; i++) {
+    if (v.at(i) > v.at(best)) best = i;
+  }
+  return best;
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Kernel against a scalar loop, including a row tail
+  {
+    const size_t m = 7, n = 96;
+    rook::AlignedArray<int8_t>  a(m*n);
+    rook::AlignedArray<uint8_t> x(n);
+    for (size_t i = 0; i < m*n; i++) a[i] = (int8_t)(rand()%255 - 127);
+    for (size_t j = 0; j < n;   j++) x[j] = (uint8_t)(rand()%128);
+
+    // The worst case for 16-bit pair sums
+    for (size_t j = 0; j < n; j++) a[j] = 127;
+    for (size_t j = 0; j < n; j++) a[n + j] = -127;
+    x[0] = x[1] = 127;
+
+    int32_t y[m];
+    rook::quantized::dotKernel(m, n, a.data(), x.data(), y);
+    bool exact = true;
+    for (size_t i = 0; i < m; i++) {
+      int32_t expected = 0;
+      for (size_t j = 0; j < n; j++) expected += (int32_t)x[j] * a[i*n + j];
+      exact = exact && y[i] == expected;
+    }
+    check("dot kernel", exact);
+  }
+
+  typedef rook::Layer<128, 64>               Hidden;
+  typedef rook::Layer< 64, 10, rook::Linear> Output;
+  typedef rook::FeedForwardNetwork<Hidden, Output> Network;
+
+  rook::seedInitialization(5);
+  Network network;
+  network.getLayer()                    = Hidden(rook::Initialization::xavier(128, 64));
+  network.getRemainNetwork().getLayer() = Output(rook::Initialization::xavier(64, 10));
+
+  std::vector<Network::Input> calibration, samples;
+  for (size_t i = 0; i < 200; i++) calibration.push_back(Network::Input(uniform));
+  for (size_t i = 0; i < 200; i++) samples.push_back(Network::Input(uniform));
+
+  // A layer is exactly its integer product, rescaled
+  {
+    rook::Range range;
+    for (const auto& c : calibration) range.add(c.raw().data(), 128);
+    const Hidden& layer = network.getLayer();
+    const rook::QuantizedLayer<Hidden> quantized(layer, range);
+
+    const auto& input = samples[0];
+    const auto  y     = quantized.infer(input);
+    bool ok = true;
+    for (size_t i = 0; i < 64; i++) {
+      int32_t dot = 0, sum = 0;
+      for (size_t j = 0; j < 128; j++) {
+        const float   v = input.at(j)/quantized.inputScale() + quantized.zero();
+        const int32_t q = (int32_t)(std::min(std::max(v, 0.0f), 127.0f) + 0.5f);
+        dot += q * quantized.weights()[i*Hidden::Input::rows + j];
+        sum += quantized.weights()[i*Hidden::Input::rows + j];
+      }
+      float largest = 0.0f;
+      for (size_t j = 0; j < 128; j++) {
+        largest = std::max(largest, std::fabs(layer.getWeightMatrix().at(i, j)));
+      }
+      const float z = (dot - quantized.zero()*sum) * quantized.inputScale() * largest/127.0f + 
+                      layer.getBias().at(i);
+      ok = ok && std::fabs(1.0f/(1.0f + std::exp(-z)) - y.at(i)) < 1.0e-4f;
+    }
+    check("quantized layer", ok);
+  }
+
+  // The whole network, against float
+  {
+    const rook::QuantizedNetwork<Network> quantized(network, calibration);
+
+    float  worst  = 0.0f;
+    size_t agreed = 0;
+    for (const auto& sample : samples) {
+      const auto expected = network.infer(sample);
+      const auto actual   = quantized.infer(sample);
+      for (size_t i = 0; i < 10; i++) {
+        worst = std::max(worst, std::fabs(expected.at(i) - actual.at(i)));
+      }
+      agreed += argmax(expected) == argmax(actual);
+    }
+    std::cout << "largest difference " << worst << ", " 
+              << agreed << "/" << samples.size() << " agree" << std::endl;
+    check("quantized network", worst < 0.05f && agreed >= samples.size()*95/100);
+
+    // Threads sharing the network each get their own answers
+    std::vector<Network::Output> serial, shared(samples.size());
+    for (const auto& sample : samples) serial.push_back(quantized.infer(sample));
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+      threads.emplace_back([&, t] {
+        for (size_t r = 0; r < 50; r++) {
+          for (size_t i = t; i < samples.size(); i += 4) shared[i] = quantized.infer(samples[i]);
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    check("quantized network is thread safe", shared == serial);
+
+    const size_t floatBytes = (128*64 + 64 + 64*10 + 10)*sizeof(float);
+    check("quantized memory", quantized.weightBytes()*7 < floatBytes*2);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,228 @@
+//------------------------------------------------------------------------------
+/*
+*
+*  The MIT License (MIT)
+*
+*  Copyright (C) 2014 Cody Griffin (cody.m.griffin@gmail.com)
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  The above copyright notice and this permission notice shall be included in all
+*  copies or substantial portions of the Software.
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+*  SOFTWARE.
+*/
+
+#include "Sampler.h"
+#include "Encoding.h"
+#include "Corruption.h"
+#include "Check.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+
+//------------------------------------------------------------------------------
+/*
+ * Runtime checks for the random number generators, the epoch sampler and
+ * corruption: streams are reproducible, vector and scalar generation agree,
+ * orders are permutations, block shuffles keep blocks together, and noise
+ * has the rates and moments asked for.
+ *
+ */
+
+bool permutation(const rook::EpochSampler& sampler) {
+  std::vector<size_t> sorted = sampler.order();
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    if (sorted[i] != i) return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+int main() {
+  // Reproducible, and roughly uniform
+  {
+    rook::Random a(42), b(42), c(43);
+    bool same = true, different = false;
+    for (size_t i = 0; i < 100; i++) {
+      const uint64_t x = a();
+      same      = same && x == b();
+      different = different || x != c();
+    }
+    check("random seeds", same && different);
+
+    size_t counts[10] = {};
+    double sum = 0.0;
+    bool   bounded = true;
+    for (size_t i = 0; i < 100000; i++) {
+      counts[a.below(10)]++;
+      const float u = a.uniform();
+      bounded = bounded && u >= 0.0f && u < 1.0f;
+      sum += u;
+    }
+    bool flat = true;
+    for (auto n : counts) flat = flat && n > 9500 && n < 10500;
+    check("random below", flat);
+    check("random uniform", bounded && std::fabs(sum/100000 - 0.5) < 0.01);
+  }
+
+  // Every epoch is a different permutation, and the same one for the same
+  // seed and epoch
+  {
+    rook::EpochSampler a(1000, 7), b(1000, 7);
+    const auto first = a.order();
+    a.next();
+    b.epoch(1);
+    check("sampler permutes", permutation(a) && a.order() != first);
+    check("sampler replays", a.order() == b.order() && a.epoch() == 1);
+  }
+
+  // Block shuffles keep each block of consecutive samples together 
+  {
+    rook::EpochSampler sampler(1000, 7, 64);
+    size_t runs = 1;
+    for (size_t i = 1; i < sampler.size(); i++) {
+      runs += sampler[i]/64 != sampler[i - 1]/64;
+    }
+    const bool together = runs == (1000 + 63)/64;
+    check("sampler blocks", permutation(sampler) && together && sampler.order()[0] != 0);
+  }
+
+  // Gathered batches hold the sampled samples, in order
+  {
+    std::vector<uint8_t> samples(100*12);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = (uint8_t)(i*7);
+    const auto e = rook::Encoding::unit(12);
+
+    rook::EpochSampler sampler(100, 3);
+    rook::Matrix<12, 16> batch;
+    rook::gatherBatch(samples.data(), 12, sampler.batch(2, 16), e, batch);
+    bool ok = true;
+    for (size_t p = 0; p < 12; p++) {
+      for (size_t b = 0; b < 16; b++) {
+        ok = ok && std::fabs(batch.at(p, b) - samples[sampler[32 + b]*12 + p]/255.0f) < 1.0e-6f;
+      }
+    }
+    check("gather batch", ok);
+  }
+
+  // Counter-based streams: reproducible, distinct per stream, and the same
+  // numbers whatever the vector width
+  {
+    rook::CounterRandom a(9, 0), b(9, 0), c(9, 1);
+    std::vector<float> x(1001), y(1001), z(1001);
+    a.uniform(x.data(), x.size());
+    b.uniform(y.data(), y.size());
+    c.uniform(z.data(), z.size());
+    check("counter streams", x == y && x != z);
+
+    rook::CounterRandom scalar(9, 0);
+    bool same = true;
+    for (size_t i = 0; i < 1000; i++) {
+      same = same && scalar.uniform<rook::math::Scalar>() == x[i];
+    }
+    check("counter widths agree", same);
+
+    double sum = 0.0, squares = 0.0;
+    bool bounded = true;
+    std::vector<float> u(100000), n(100001);
+    a.uniform(u.data(), u.size());
+    for (auto v : u) {
+      bounded = bounded && v >= 0.0f && v < 1.0f;
+      sum += v;
+    }
+    check("counter uniform", bounded && std::fabs(sum/u.size() - 0.5) < 0.01);
+
+    sum = 0.0;
+    a.normal(n.data(), n.size(), 1.0f, 2.0f);
+    for (auto v : n) {
+      sum     += v;
+      squares += v*v;
+    }
+    const double mean = sum/n.size();
+    check("counter normal", std::fabs(mean - 1.0) < 0.03 && std::fabs(squares/n.size() - mean*mean - 4.0) < 0.1);
+  }
+
+  // The vectorized log behind the normals
+  {
+    float worst = 0.0f;
+    for (float x = 1.0e-30f; x < 1.0e30f; x *= 1.37f) {
+      typedef rook::math::Native V;
+      float lanes[V::width];
+      V::store(lanes, rook::math::log<V>(V::set(x)));
+      const float y = lanes[0];
+      worst = std::max(worst, std::fabs(y - std::log(x))/std::max(1.0f, std::fabs(std::log(x))));
+    }
+    check("log", worst < 1.0e-6f);
+  }
+
+  // Each kind of noise
+  {
+    const size_t count = 100003;
+    std::vector<float> x(count, 0.5f), y(count);
+    rook::CounterRandom random(3);
+
+    rook::Corruption::dropout(0.3f).apply(x.data(), y.data(), count, random);
+    size_t dropped = 0;
+    bool   kept    = true;
+    for (auto v : y) {
+      dropped += v == 0.0f;
+      kept     = kept && (v == 0.0f || v == 0.5f);
+    }
+    check("dropout", kept && std::fabs((double)dropped/count - 0.3) < 0.01);
+
+    rook::Corruption::saltAndPepper(0.2f).apply(x.data(), y.data(), count, random);
+    size_t salt = 0, pepper = 0;
+    for (auto v : y) {
+      salt   += v == 1.0f;
+      pepper += v == 0.0f;
+    }
+    check("salt and pepper", std::fabs((double)salt/count - 0.1) < 0.01 && 
+                             std::fabs((double)pepper/count - 0.1) < 0.01 &&
+                             salt + pepper + std::count(y.begin(), y.end(), 0.5f) == count);
+
+    y = x;
+    rook::Corruption::gaussian(0.1f).apply(y.data(), y.data(), count, random);
+    double sum = 0.0, squares = 0.0;
+    for (auto v : y) {
+      sum     += v - 0.5f;
+      squares += (v - 0.5f)*(v - 0.5f);
+    }
+    check("gaussian", std::fabs(sum/count) < 0.002 && std::fabs(squares/count - 0.01) < 0.0005);
+
+    const rook::ColVector<37> v([](size_t) { return 1.0f; });
+    rook::CounterRandom r0(4), r1(4);
+    const auto w = rook::Corruption::dropout(0.5f).apply(v, r0);
+    std::vector<float> expected(37);
+    rook::Corruption::dropout(0.5f).apply(v.raw().data(), expected.data(), 37, r1);
+    check("corrupt matrix", std::equal(expected.begin(), expected.end(), w.raw().begin()));
+
+    // A thread's own stream comes from the seed sequence, so a seeded run
+    // corrupts the same way every time
+    std::vector<float> first(count), second(count);
+    for (auto out : {&first, &second}) {
+      rook::seedInitialization(11);
+      std::thread([&] { rook::Corruption::gaussian(0.1f).apply(x.data(), out->data(), count); }).join();
+    }
+    check("seeded thread streams", first == second);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------